@@ -0,0 +1,8 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test-valgrind"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/test-valgrind.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
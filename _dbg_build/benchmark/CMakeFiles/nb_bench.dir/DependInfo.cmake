@@ -0,0 +1,25 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/benchmark/compare.cpp" "benchmark/CMakeFiles/nb_bench.dir/compare.cpp.o" "gcc" "benchmark/CMakeFiles/nb_bench.dir/compare.cpp.o.d"
+  "/root/repo/benchmark/launch.cpp" "benchmark/CMakeFiles/nb_bench.dir/launch.cpp.o" "gcc" "benchmark/CMakeFiles/nb_bench.dir/launch.cpp.o.d"
+  "/root/repo/benchmark/matrix.cpp" "benchmark/CMakeFiles/nb_bench.dir/matrix.cpp.o" "gcc" "benchmark/CMakeFiles/nb_bench.dir/matrix.cpp.o.d"
+  "/root/repo/benchmark/nb_bench.cpp" "benchmark/CMakeFiles/nb_bench.dir/nb_bench.cpp.o" "gcc" "benchmark/CMakeFiles/nb_bench.dir/nb_bench.cpp.o.d"
+  "/root/repo/benchmark/process.cpp" "benchmark/CMakeFiles/nb_bench.dir/process.cpp.o" "gcc" "benchmark/CMakeFiles/nb_bench.dir/process.cpp.o.d"
+  "/root/repo/benchmark/results.cpp" "benchmark/CMakeFiles/nb_bench.dir/results.cpp.o" "gcc" "benchmark/CMakeFiles/nb_bench.dir/results.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_dbg_build/common/CMakeFiles/netbench.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
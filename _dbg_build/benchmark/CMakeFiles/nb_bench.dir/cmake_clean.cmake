@@ -0,0 +1,21 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/nb_bench.dir/compare.cpp.o"
+  "CMakeFiles/nb_bench.dir/compare.cpp.o.d"
+  "CMakeFiles/nb_bench.dir/launch.cpp.o"
+  "CMakeFiles/nb_bench.dir/launch.cpp.o.d"
+  "CMakeFiles/nb_bench.dir/matrix.cpp.o"
+  "CMakeFiles/nb_bench.dir/matrix.cpp.o.d"
+  "CMakeFiles/nb_bench.dir/nb_bench.cpp.o"
+  "CMakeFiles/nb_bench.dir/nb_bench.cpp.o.d"
+  "CMakeFiles/nb_bench.dir/process.cpp.o"
+  "CMakeFiles/nb_bench.dir/process.cpp.o.d"
+  "CMakeFiles/nb_bench.dir/results.cpp.o"
+  "CMakeFiles/nb_bench.dir/results.cpp.o.d"
+  "nb_bench"
+  "nb_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/nb_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
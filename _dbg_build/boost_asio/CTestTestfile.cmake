@@ -0,0 +1,8 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/boost_asio
+# Build directory: /root/repo/_dbg_build/boost_asio
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+subdirs("pingpong")
+subdirs("pingpong_threads_")
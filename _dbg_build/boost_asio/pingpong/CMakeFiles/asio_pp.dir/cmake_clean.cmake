@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/asio_pp.dir/client.cpp.o"
+  "CMakeFiles/asio_pp.dir/client.cpp.o.d"
+  "CMakeFiles/asio_pp.dir/cmake_pch.hxx.gch"
+  "CMakeFiles/asio_pp.dir/cmake_pch.hxx.gch.d"
+  "CMakeFiles/asio_pp.dir/server.cpp.o"
+  "CMakeFiles/asio_pp.dir/server.cpp.o.d"
+  "asio_pp"
+  "asio_pp.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/asio_pp.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
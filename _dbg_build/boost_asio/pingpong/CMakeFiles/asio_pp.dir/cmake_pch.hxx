@@ -0,0 +1,6 @@
+/* generated by CMake */
+
+#pragma GCC system_header
+#ifdef __cplusplus
+#include "/root/repo/boost_asio/pingpong/pch.h"
+#endif // __cplusplus
@@ -0,0 +1,25 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/boost_asio/pingpong_threads_/client.cpp" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/client.cpp.o" "gcc" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/client.cpp.o.d"
+  "/root/repo/_dbg_build/boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/cmake_pch.hxx" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/client.cpp.o" "gcc" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/client.cpp.o.d"
+  "/root/repo/_dbg_build/boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/cmake_pch.hxx.cxx" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/cmake_pch.hxx.gch" "gcc" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/cmake_pch.hxx.gch.d"
+  "/root/repo/_dbg_build/boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/cmake_pch.hxx" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/cmake_pch.hxx.gch" "gcc" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/cmake_pch.hxx.gch.d"
+  "/root/repo/boost_asio/pingpong_threads_/server.cpp" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/server.cpp.o" "gcc" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/server.cpp.o.d"
+  "/root/repo/_dbg_build/boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/cmake_pch.hxx" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/server.cpp.o" "gcc" "boost_asio/pingpong_threads_/CMakeFiles/asio_pp_threads.dir/server.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_dbg_build/common/CMakeFiles/netbench.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,6 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/boost_asio/pingpong_threads_
+# Build directory: /root/repo/_dbg_build/boost_asio/pingpong_threads_
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
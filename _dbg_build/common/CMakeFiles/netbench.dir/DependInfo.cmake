@@ -0,0 +1,30 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/common/affinity.c" "common/CMakeFiles/netbench.dir/affinity.c.o" "gcc" "common/CMakeFiles/netbench.dir/affinity.c.o.d"
+  "/root/repo/common/cputime.c" "common/CMakeFiles/netbench.dir/cputime.c.o" "gcc" "common/CMakeFiles/netbench.dir/cputime.c.o.d"
+  "/root/repo/common/crc32c.c" "common/CMakeFiles/netbench.dir/crc32c.c.o" "gcc" "common/CMakeFiles/netbench.dir/crc32c.c.o.d"
+  "/root/repo/common/histogram.c" "common/CMakeFiles/netbench.dir/histogram.c.o" "gcc" "common/CMakeFiles/netbench.dir/histogram.c.o.d"
+  "/root/repo/common/inflight.c" "common/CMakeFiles/netbench.dir/inflight.c.o" "gcc" "common/CMakeFiles/netbench.dir/inflight.c.o.d"
+  "/root/repo/common/perf.c" "common/CMakeFiles/netbench.dir/perf.c.o" "gcc" "common/CMakeFiles/netbench.dir/perf.c.o.d"
+  "/root/repo/common/ready.c" "common/CMakeFiles/netbench.dir/ready.c.o" "gcc" "common/CMakeFiles/netbench.dir/ready.c.o.d"
+  "/root/repo/common/report.c" "common/CMakeFiles/netbench.dir/report.c.o" "gcc" "common/CMakeFiles/netbench.dir/report.c.o.d"
+  "/root/repo/common/result.c" "common/CMakeFiles/netbench.dir/result.c.o" "gcc" "common/CMakeFiles/netbench.dir/result.c.o.d"
+  "/root/repo/common/sizes.c" "common/CMakeFiles/netbench.dir/sizes.c.o" "gcc" "common/CMakeFiles/netbench.dir/sizes.c.o.d"
+  "/root/repo/common/stats.c" "common/CMakeFiles/netbench.dir/stats.c.o" "gcc" "common/CMakeFiles/netbench.dir/stats.c.o.d"
+  "/root/repo/common/verify.c" "common/CMakeFiles/netbench.dir/verify.c.o" "gcc" "common/CMakeFiles/netbench.dir/verify.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
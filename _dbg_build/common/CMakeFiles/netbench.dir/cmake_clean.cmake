@@ -0,0 +1,33 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/netbench.dir/affinity.c.o"
+  "CMakeFiles/netbench.dir/affinity.c.o.d"
+  "CMakeFiles/netbench.dir/cputime.c.o"
+  "CMakeFiles/netbench.dir/cputime.c.o.d"
+  "CMakeFiles/netbench.dir/crc32c.c.o"
+  "CMakeFiles/netbench.dir/crc32c.c.o.d"
+  "CMakeFiles/netbench.dir/histogram.c.o"
+  "CMakeFiles/netbench.dir/histogram.c.o.d"
+  "CMakeFiles/netbench.dir/inflight.c.o"
+  "CMakeFiles/netbench.dir/inflight.c.o.d"
+  "CMakeFiles/netbench.dir/perf.c.o"
+  "CMakeFiles/netbench.dir/perf.c.o.d"
+  "CMakeFiles/netbench.dir/ready.c.o"
+  "CMakeFiles/netbench.dir/ready.c.o.d"
+  "CMakeFiles/netbench.dir/report.c.o"
+  "CMakeFiles/netbench.dir/report.c.o.d"
+  "CMakeFiles/netbench.dir/result.c.o"
+  "CMakeFiles/netbench.dir/result.c.o.d"
+  "CMakeFiles/netbench.dir/sizes.c.o"
+  "CMakeFiles/netbench.dir/sizes.c.o.d"
+  "CMakeFiles/netbench.dir/stats.c.o"
+  "CMakeFiles/netbench.dir/stats.c.o.d"
+  "CMakeFiles/netbench.dir/verify.c.o"
+  "CMakeFiles/netbench.dir/verify.c.o.d"
+  "libnetbench.a"
+  "libnetbench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/netbench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,9 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/libevent
+# Build directory: /root/repo/_dbg_build/libevent
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+subdirs("ioevent_bench")
+subdirs("pingpong_buffered")
+subdirs("http_bench")
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/event_http_bench.dir/http_bench.c.o"
+  "CMakeFiles/event_http_bench.dir/http_bench.c.o.d"
+  "event_http_bench"
+  "event_http_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/event_http_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
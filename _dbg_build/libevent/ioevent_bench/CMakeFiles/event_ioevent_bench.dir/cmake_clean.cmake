@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/event_ioevent_bench.dir/ioevent_bench.c.o"
+  "CMakeFiles/event_ioevent_bench.dir/ioevent_bench.c.o.d"
+  "event_ioevent_bench"
+  "event_ioevent_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/event_ioevent_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,22 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/libevent/pingpong_buffered/client.c" "libevent/pingpong_buffered/CMakeFiles/event_pp.dir/client.c.o" "gcc" "libevent/pingpong_buffered/CMakeFiles/event_pp.dir/client.c.o.d"
+  "/root/repo/libevent/pingpong_buffered/evmem.c" "libevent/pingpong_buffered/CMakeFiles/event_pp.dir/evmem.c.o" "gcc" "libevent/pingpong_buffered/CMakeFiles/event_pp.dir/evmem.c.o.d"
+  "/root/repo/libevent/pingpong_buffered/server.c" "libevent/pingpong_buffered/CMakeFiles/event_pp.dir/server.c.o" "gcc" "libevent/pingpong_buffered/CMakeFiles/event_pp.dir/server.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_dbg_build/common/CMakeFiles/netbench.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
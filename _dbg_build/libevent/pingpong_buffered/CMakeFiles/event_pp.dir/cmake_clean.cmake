@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/event_pp.dir/client.c.o"
+  "CMakeFiles/event_pp.dir/client.c.o.d"
+  "CMakeFiles/event_pp.dir/evmem.c.o"
+  "CMakeFiles/event_pp.dir/evmem.c.o.d"
+  "CMakeFiles/event_pp.dir/server.c.o"
+  "CMakeFiles/event_pp.dir/server.c.o.d"
+  "event_pp"
+  "event_pp.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/event_pp.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,6 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/libevent/pingpong_buffered
+# Build directory: /root/repo/_dbg_build/libevent/pingpong_buffered
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
@@ -1,2 +1,4 @@
+add_subdirectory (common)
 add_subdirectory (boost_asio)
 add_subdirectory (libevent)
+add_subdirectory (benchmark)
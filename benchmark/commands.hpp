@@ -0,0 +1,15 @@
+#ifndef _COMMANDS_HPP
+#define _COMMANDS_HPP
+
+// nb_bench subcommands, argv[0] is subcommand name. Return process exit status.
+
+// run matrix of benchmark configurations with repetitions
+int matrix_main(int argc, char ** argv);
+
+// compare result sets, non-zero status on regressions
+int compare_main(int argc, char ** argv);
+
+// run server and client processes of one benchmark, collect client records
+int launch_main(int argc, char ** argv);
+
+#endif /* _COMMANDS_HPP */
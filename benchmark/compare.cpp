@@ -0,0 +1,192 @@
+//
+// compare.cpp
+// ~~~~~~~~~~~
+//
+// Compares two result sets per configuration with Mann-Whitney U test on repetitions,
+// exits with non-zero status on throughput or latency regressions.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "commands.hpp"
+#include "results.hpp"
+#include "sample_stats.hpp"
+
+namespace
+{
+
+const char * const default_metrics = "msg_s,req_s,p50_us,p99_us,p999_us,avg_us";
+
+// Metrics where bigger is better, others are latencies or costs
+const char * const throughput_metrics[] = {
+    "msg_s",
+    "mib_s",
+    "req_s",
+    "accept_rate",
+};
+
+bool higher_is_better(const std::string & metric)
+{
+    for (const char * m : throughput_metrics)
+    {
+        if (metric == m)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> split_list(const std::string & list)
+{
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+double median(const std::vector<double> & samples)
+{
+    return summarize(samples).median;
+}
+
+void compare_usage(const char * prog)
+{
+    fprintf(stderr, "Usage: %s compare [-t threshold] [-a alpha] [-m metrics] <baseline.jsonl> <current.jsonl>\n", prog);
+    fprintf(stderr, "  [-t threshold] (regression if median is worse by more than threshold percents, default 5)\n");
+    fprintf(stderr, "  [-a alpha] (Mann-Whitney significance level, default 0.05)\n");
+    fprintf(stderr, "  [-m metrics] (comma separated, default %s)\n", default_metrics);
+}
+
+} // namespace
+
+int compare_main(int argc, char ** argv)
+{
+    double threshold = 5;
+    double alpha = 0.05;
+    std::string metrics_list = default_metrics;
+    int c;
+
+    while ((c = getopt(argc, argv, "t:a:m:h")) != -1)
+    {
+        switch (c)
+        {
+            case 't':
+                threshold = atof(optarg);
+                if (threshold < 0)
+                {
+                    fprintf(stderr, "Invalid threshold\n");
+                    return 2;
+                }
+                break;
+            case 'a':
+                alpha = atof(optarg);
+                if (alpha <= 0 || alpha >= 1)
+                {
+                    fprintf(stderr, "Invalid alpha\n");
+                    return 2;
+                }
+                break;
+            case 'm':
+                metrics_list = optarg;
+                break;
+            default:
+                compare_usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind + 2 != argc)
+    {
+        compare_usage(argv[0]);
+        return 2;
+    }
+
+    result_set baseline;
+    result_set current;
+    if (!results_load(argv[optind], baseline) || !results_load(argv[optind + 1], current))
+    {
+        return 2;
+    }
+    std::vector<std::string> metrics = split_list(metrics_list);
+
+    size_t regressions = 0;
+    size_t missing = 0;
+    size_t compared = 0;
+    printf("%-12s %14s %14s %9s %8s  %s\n", "Metric", "Baseline", "Current", "Change %", "p", "Verdict");
+    for (const auto & base : baseline.points)
+    {
+        const result_point * cur = current.find(base.key);
+        printf("%s\n", base.label.c_str());
+        for (auto & name : metrics)
+        {
+            const std::vector<double> * base_samples = base.find_metric(name);
+            if (!base_samples || base_samples->empty())
+            {
+                continue; // metric of other engine
+            }
+            const std::vector<double> * cur_samples = cur ? cur->find_metric(name) : nullptr;
+            if (!cur_samples || cur_samples->empty())
+            {
+                ++missing;
+                printf("%-12s %14.3f %14s %9s %8s  %s\n", name.c_str(), median(*base_samples), "-", "-", "-", "missing");
+                continue;
+            }
+
+            double base_median = median(*base_samples);
+            double cur_median = median(*cur_samples);
+            double change = base_median != 0 ? 100 * (cur_median - base_median) / base_median : 0;
+            // test that can't reach alpha with these sample counts would hide every change, verdict is by threshold only
+            bool tested = mann_whitney_min_p(base_samples->size(), cur_samples->size()) < alpha;
+            double p = tested ? mann_whitney_p(*base_samples, *cur_samples) : 0;
+            bool significant = !tested || p < alpha;
+            double worse = higher_is_better(name) ? -change : change;
+
+            const char * verdict = "ok";
+            if (significant && worse > threshold)
+            {
+                verdict = "REGRESSION";
+                ++regressions;
+            }
+            else if (significant && -worse > threshold)
+            {
+                verdict = "improvement";
+            }
+            ++compared;
+
+            char p_str[16];
+            if (tested)
+            {
+                snprintf(p_str, sizeof(p_str), "%.4f", p);
+            }
+            else
+            {
+                snprintf(p_str, sizeof(p_str), "-");
+            }
+            printf("%-12s %14.3f %14.3f %+9.2f %8s  %s\n", name.c_str(), base_median, cur_median, change, p_str, verdict);
+        }
+    }
+
+    fprintf(
+        stderr,
+        "%zu metrics compared, %zu regressions, %zu missing (threshold %.1f%%, alpha %.3f)\n",
+        compared,
+        regressions,
+        missing,
+        threshold,
+        alpha);
+    return regressions || missing ? 1 : 0;
+}
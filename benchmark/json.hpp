@@ -0,0 +1,355 @@
+#ifndef _JSON_HPP
+#define _JSON_HPP
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal JSON reader and writer for benchmark records (JSON Lines of --format=json and driver results).
+// No unicode unescaping besides \uXXXX below 0x80, records contain only ASCII keys and values.
+struct json_value
+{
+    enum kind_t
+    {
+        null_v,
+        boolean_v,
+        number_v,
+        string_v,
+        array_v,
+        object_v
+    };
+
+    kind_t kind = null_v;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<json_value> array;
+    std::vector<std::pair<std::string, json_value>> object; // in record order
+
+    const json_value * find(const std::string & key) const
+    {
+        for (auto & kv : object)
+        {
+            if (kv.first == key)
+            {
+                return &kv.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class json_parser
+{
+public:
+    explicit json_parser(const std::string & text) : p_(text.c_str()) { }
+
+    // Parse one value, trailing garbage is an error
+    bool parse(json_value & v)
+    {
+        if (!value(v))
+        {
+            return false;
+        }
+        skip();
+        return *p_ == '\0';
+    }
+
+private:
+    void skip()
+    {
+        while (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')
+        {
+            ++p_;
+        }
+    }
+
+    bool literal(const char * word)
+    {
+        size_t i = 0;
+        for (; word[i]; ++i)
+        {
+            if (p_[i] != word[i])
+            {
+                return false;
+            }
+        }
+        p_ += i;
+        return true;
+    }
+
+    bool string(std::string & s)
+    {
+        if (*p_ != '"')
+        {
+            return false;
+        }
+        for (++p_; *p_ != '"'; ++p_)
+        {
+            if (*p_ == '\0')
+            {
+                return false;
+            }
+            if (*p_ != '\\')
+            {
+                s += *p_;
+                continue;
+            }
+            ++p_;
+            switch (*p_)
+            {
+                case 'n':
+                    s += '\n';
+                    break;
+                case 't':
+                    s += '\t';
+                    break;
+                case 'r':
+                    s += '\r';
+                    break;
+                case 'b':
+                    s += '\b';
+                    break;
+                case 'f':
+                    s += '\f';
+                    break;
+                case 'u': {
+                    char hex[5] = {0};
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        if (p_[1 + i] == '\0')
+                        {
+                            return false;
+                        }
+                        hex[i] = p_[1 + i];
+                    }
+                    s += static_cast<char>(strtol(hex, nullptr, 16));
+                    p_ += 4;
+                    break;
+                }
+                case '\0':
+                    return false;
+                default:
+                    s += *p_;
+            }
+        }
+        ++p_;
+        return true;
+    }
+
+    bool value(json_value & v)
+    {
+        skip();
+        if (*p_ == '{')
+        {
+            v.kind = json_value::object_v;
+            ++p_;
+            skip();
+            if (*p_ == '}')
+            {
+                ++p_;
+                return true;
+            }
+            for (;;)
+            {
+                std::pair<std::string, json_value> kv;
+                skip();
+                if (!string(kv.first))
+                {
+                    return false;
+                }
+                skip();
+                if (*p_++ != ':' || !value(kv.second))
+                {
+                    return false;
+                }
+                v.object.push_back(std::move(kv));
+                skip();
+                if (*p_ == '}')
+                {
+                    ++p_;
+                    return true;
+                }
+                if (*p_++ != ',')
+                {
+                    return false;
+                }
+            }
+        }
+        if (*p_ == '[')
+        {
+            v.kind = json_value::array_v;
+            ++p_;
+            skip();
+            if (*p_ == ']')
+            {
+                ++p_;
+                return true;
+            }
+            for (;;)
+            {
+                v.array.emplace_back();
+                if (!value(v.array.back()))
+                {
+                    return false;
+                }
+                skip();
+                if (*p_ == ']')
+                {
+                    ++p_;
+                    return true;
+                }
+                if (*p_++ != ',')
+                {
+                    return false;
+                }
+            }
+        }
+        if (*p_ == '"')
+        {
+            v.kind = json_value::string_v;
+            return string(v.string);
+        }
+        if (literal("null"))
+        {
+            v.kind = json_value::null_v;
+            return true;
+        }
+        if (literal("true"))
+        {
+            v.kind = json_value::boolean_v;
+            v.boolean = true;
+            return true;
+        }
+        if (literal("false"))
+        {
+            v.kind = json_value::boolean_v;
+            v.boolean = false;
+            return true;
+        }
+        char * end;
+        v.number = strtod(p_, &end);
+        if (end == p_)
+        {
+            return false;
+        }
+        v.kind = json_value::number_v;
+        p_ = end;
+        return true;
+    }
+
+    const char * p_;
+};
+
+inline json_value make_string(const std::string & s)
+{
+    json_value v;
+    v.kind = json_value::string_v;
+    v.string = s;
+    return v;
+}
+
+inline json_value make_number(double n)
+{
+    json_value v;
+    v.kind = json_value::number_v;
+    v.number = n;
+    return v;
+}
+
+inline void json_write_string(std::string & out, const std::string & s)
+{
+    out += '"';
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+            out += buf;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// Shortest form which reads back the same, null for nan and inf
+inline void json_write_number(std::string & out, double n)
+{
+    if (!std::isfinite(n))
+    {
+        out += "null";
+        return;
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.17g", n);
+    for (int precision = 6; precision < 17; ++precision)
+    {
+        char shorter[32];
+        snprintf(shorter, sizeof(shorter), "%.*g", precision, n);
+        if (strtod(shorter, nullptr) == n)
+        {
+            out += shorter;
+            return;
+        }
+    }
+    out += buf;
+}
+
+inline void json_write(std::string & out, const json_value & v)
+{
+    switch (v.kind)
+    {
+        case json_value::null_v:
+            out += "null";
+            break;
+        case json_value::boolean_v:
+            out += v.boolean ? "true" : "false";
+            break;
+        case json_value::number_v:
+            json_write_number(out, v.number);
+            break;
+        case json_value::string_v:
+            json_write_string(out, v.string);
+            break;
+        case json_value::array_v:
+            out += '[';
+            for (size_t i = 0; i < v.array.size(); ++i)
+            {
+                if (i)
+                {
+                    out += ", ";
+                }
+                json_write(out, v.array[i]);
+            }
+            out += ']';
+            break;
+        case json_value::object_v:
+            out += '{';
+            for (size_t i = 0; i < v.object.size(); ++i)
+            {
+                if (i)
+                {
+                    out += ", ";
+                }
+                json_write_string(out, v.object[i].first);
+                out += ": ";
+                json_write(out, v.object[i].second);
+            }
+            out += '}';
+            break;
+    }
+}
+
+#endif /* _JSON_HPP */
@@ -0,0 +1,186 @@
+//
+// launch.cpp
+// ~~~~~~~~~~
+//
+// Runs server and clients of one benchmark as separate processes: server is started first and its
+// readiness is awaited on a pipe (--ready-fd), then client processes run in parallel against it
+// (-a), their records are collected and the server is stopped with SIGTERM.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <netbench/clock.h>
+#include <netbench/cputime.h>
+#include <netbench/ready.h>
+
+#include "commands.hpp"
+#include "json.hpp"
+#include "process.hpp"
+
+namespace
+{
+
+void launch_usage(const char * prog)
+{
+    fprintf(stderr, "Usage: %s launch [-c clients] [-t timeout] [-r ready_timeout] [-o file] [-v] -s <server command> <client command>\n", prog);
+    fprintf(stderr, "  -s command (server only mode command, one argument: \"./asio_pp -T 4 --server-cpus=0-3\")\n");
+    fprintf(stderr, "  [-c clients] (client processes, each runs client command, default 1)\n");
+    fprintf(stderr, "  [-t timeout] (clients are killed after timeout, s, default no limit)\n");
+    fprintf(stderr, "  [-r ready_timeout] (server must be listening within timeout, s, default 10)\n");
+    fprintf(stderr, "  [-o file] (client records, JSON Lines, default stdout)\n");
+    fprintf(stderr, "  [-v] (pass server and client stderr through)\n");
+}
+
+} // namespace
+
+int launch_main(int argc, char ** argv)
+{
+    std::vector<std::string> server_command;
+    const char * output = nullptr;
+    int clients = 1;
+    int timeout = 0;
+    int ready_timeout = 10;
+    bool verbose = false;
+    int c;
+
+    // client command options are not ours
+    while ((c = getopt(argc, argv, "+s:c:t:r:o:vh")) != -1)
+    {
+        switch (c)
+        {
+            case 's':
+                server_command = split(optarg);
+                break;
+            case 'c':
+                clients = atoi(optarg);
+                break;
+            case 't':
+                timeout = atoi(optarg);
+                break;
+            case 'r':
+                ready_timeout = atoi(optarg);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                launch_usage(argv[0]);
+                return 2;
+        }
+    }
+    if (server_command.empty() || optind == argc || clients <= 0 || timeout < 0 || ready_timeout <= 0)
+    {
+        launch_usage(argv[0]);
+        return 2;
+    }
+    std::vector<std::string> client_command(argv + optind, argv + argc);
+    client_command.push_back("--format=json");
+
+    // server
+    int ready_fds[2];
+    if (pipe2(ready_fds, O_CLOEXEC) == -1)
+    {
+        perror("pipe");
+        return 2;
+    }
+    // server configuration (-T, --accept, allocators, CPUs) is not in client records
+    std::string server_config = join(server_command);
+    server_command.push_back("--ready-fd=3");
+    child_process server;
+    bool started = process_start(server, server_command, false, verbose, ready_fds[1]);
+    close(ready_fds[1]);
+    if (!started)
+    {
+        close(ready_fds[0]);
+        return 2;
+    }
+    if (nb_ready_wait(ready_fds[0], ready_timeout * 1000) == -1)
+    {
+        kill(server.pid, SIGKILL);
+        fprintf(stderr, "server: exit status %d\n", process_wait(server));
+        return 2;
+    }
+
+    // clients
+    nb_cputime_values server_start;
+    nb_cputime_read_process(server.pid, &server_start);
+    uint64_t start_ns = nb_time_ns();
+    std::vector<child_process> children(static_cast<size_t>(clients));
+    std::vector<child_process *> running;
+    for (auto & child : children)
+    {
+        if (process_start(child, client_command, true, verbose))
+        {
+            running.push_back(&child);
+        }
+    }
+    bool completed = process_collect(running, timeout ? start_ns + static_cast<uint64_t>(timeout) * 1000000000 : 0);
+    nb_cputime_values server_end;
+    nb_cputime_values server_cpu;
+    nb_cputime_read_process(server.pid, &server_end);
+    nb_cputime_diff(&server_cpu, &server_end, &server_start);
+    double elapsed = (double)(nb_time_ns() - start_ns) / 1e9;
+
+    // records with server process CPU time over the clients run (connect, warmup and measurement)
+    std::string records;
+    int failed = completed ? 0 : 1;
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        child_process & child = children[i];
+        if (child.pid == -1)
+        {
+            ++failed;
+            continue;
+        }
+        int status = process_wait(child);
+        json_value record;
+        if (status != 0 || !parse_record(child.output, record))
+        {
+            fprintf(stderr, "client %zu: %s, exit status %d\n", i + 1, completed ? "no result record" : "timeout", status);
+            ++failed;
+            continue;
+        }
+        record.object.emplace_back("client_process", make_number((double)(i + 1)));
+        record.object.emplace_back("client_processes", make_number(clients));
+        record.object.emplace_back("server_command", make_string(server_config));
+        record.object.emplace_back("server_process_user_s", make_number((double)server_cpu.user_ns / 1e9));
+        record.object.emplace_back("server_process_sys_s", make_number((double)server_cpu.sys_ns / 1e9));
+        record.object.emplace_back("server_process_cpu_cores", make_number((double)server_cpu.cpu_ns / 1e9 / elapsed));
+        json_write(records, record);
+        records += '\n';
+    }
+
+    // server releases its threads and memory on SIGTERM
+    kill(server.pid, SIGTERM);
+    int server_status = process_wait(server, 5000);
+    if (server_status != 0)
+    {
+        fprintf(stderr, "server: exit status %d\n", server_status);
+        ++failed;
+    }
+
+    FILE * out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        perror(output);
+        return 2;
+    }
+    fputs(records.c_str(), out);
+    if (output && fclose(out) != 0)
+    {
+        perror(output);
+        return 2;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,386 @@
+//
+// matrix.cpp
+// ~~~~~~~~~~
+//
+// Runs benchmark binaries over a matrix of configurations, each point is repeated in fresh processes
+// and repetitions are summarized (median, stddev, 95% CI) into one JSON Lines result file.
+//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include <netbench/clock.h>
+
+#include "commands.hpp"
+#include "json.hpp"
+#include "process.hpp"
+#include "results.hpp"
+#include "sample_stats.hpp"
+
+namespace
+{
+
+struct matrix_engine
+{
+    std::string name;
+    std::vector<std::string> command; // binary and engine specific arguments
+};
+
+struct matrix_axis
+{
+    std::string option;
+    std::vector<std::string> values;
+};
+
+struct matrix_mode
+{
+    std::string name;
+    std::vector<std::string> args;
+};
+
+struct matrix
+{
+    std::vector<matrix_engine> engines;
+    std::vector<matrix_axis> axes;
+    std::vector<matrix_mode> modes;
+    std::vector<std::string> args; // common arguments
+    int repeat = 5; // 4 or more per side lets compare reach alpha 0.05
+    int timeout = 0; // per run, s (0 - no limit)
+};
+
+// One matrix configuration with records of successful repetitions
+struct point
+{
+    std::string name; // engine/mode and axis arguments, unique in matrix
+    std::vector<std::string> command;
+    std::vector<json_value> records;
+    int failed = 0;
+};
+
+// Line oriented, # starts a comment:
+//   engine NAME PATH [ARGS...]   binary to run, may be repeated
+//   axis OPTION VALUE...         option is passed with each value, OPTION ending with '=' is joined with value
+//   mode NAME [ARGS...]          named set of arguments, may be repeated (default - one empty mode)
+//   args ARGS...                 arguments for all runs
+//   repeat K                     repetitions of each point (default 5)
+//   timeout SECONDS              run is killed and counted as failed after timeout
+bool matrix_load(const char * path, matrix & m)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+    std::string line;
+    int lineno = 0;
+    while (std::getline(in, line))
+    {
+        ++lineno;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+        std::vector<std::string> w = split(line);
+        if (w.empty())
+        {
+            continue;
+        }
+        const std::string & directive = w[0];
+        if (directive == "engine" && w.size() >= 3)
+        {
+            m.engines.push_back(matrix_engine{w[1], std::vector<std::string>(w.begin() + 2, w.end())});
+        }
+        else if (directive == "axis" && w.size() >= 3)
+        {
+            m.axes.push_back(matrix_axis{w[1], std::vector<std::string>(w.begin() + 2, w.end())});
+        }
+        else if (directive == "mode" && w.size() >= 2)
+        {
+            m.modes.push_back(matrix_mode{w[1], std::vector<std::string>(w.begin() + 2, w.end())});
+        }
+        else if (directive == "args")
+        {
+            m.args.insert(m.args.end(), w.begin() + 1, w.end());
+        }
+        else if (directive == "repeat" && w.size() == 2 && atoi(w[1].c_str()) > 0)
+        {
+            m.repeat = atoi(w[1].c_str());
+        }
+        else if (directive == "timeout" && w.size() == 2 && atoi(w[1].c_str()) >= 0)
+        {
+            m.timeout = atoi(w[1].c_str());
+        }
+        else
+        {
+            fprintf(stderr, "%s:%d: invalid line\n", path, lineno);
+            return false;
+        }
+    }
+    if (m.engines.empty())
+    {
+        fprintf(stderr, "%s: no engines\n", path);
+        return false;
+    }
+    if (m.modes.empty())
+    {
+        m.modes.push_back(matrix_mode{"default", {}});
+    }
+    return true;
+}
+
+// Cartesian product of engines, axes and modes
+std::vector<point> matrix_points(const matrix & m)
+{
+    std::vector<point> points;
+    for (auto & engine : m.engines)
+    {
+        std::vector<size_t> idx(m.axes.size(), 0);
+        for (;;)
+        {
+            for (auto & mode : m.modes)
+            {
+                point p;
+                p.name = engine.name + "/" + mode.name;
+                p.command = engine.command;
+                p.command.insert(p.command.end(), m.args.begin(), m.args.end());
+                for (size_t i = 0; i < m.axes.size(); ++i)
+                {
+                    const matrix_axis & axis = m.axes[i];
+                    const std::string & value = axis.values[idx[i]];
+                    if (axis.option.back() == '=')
+                    {
+                        p.command.push_back(axis.option + value);
+                        p.name += " " + axis.option + value;
+                    }
+                    else
+                    {
+                        p.command.push_back(axis.option);
+                        p.command.push_back(value);
+                        p.name += " " + axis.option + " " + value;
+                    }
+                }
+                p.command.insert(p.command.end(), mode.args.begin(), mode.args.end());
+                p.command.push_back("--format=json");
+                points.push_back(std::move(p));
+            }
+
+            // next axes combination, last axis changes first
+            size_t i = m.axes.size();
+            while (i > 0 && ++idx[i - 1] == m.axes[i - 1].values.size())
+            {
+                idx[--i] = 0;
+            }
+            if (i == 0)
+            {
+                break;
+            }
+        }
+    }
+    return points;
+}
+
+// Point summary: configuration from first record, metrics with statistics and samples of all repetitions
+json_value summarize_point(const point & p)
+{
+    json_value out;
+    out.kind = json_value::object_v;
+    out.object.emplace_back("point", make_string(p.name));
+    out.object.emplace_back("command", make_string(join(p.command)));
+    out.object.emplace_back("repeat", make_number((double)p.records.size()));
+    out.object.emplace_back("failed", make_number(p.failed));
+
+    json_value metrics;
+    metrics.kind = json_value::object_v;
+    if (!p.records.empty())
+    {
+        for (auto & kv : p.records.front().object)
+        {
+            if (!is_metric(kv.first, kv.second))
+            {
+                out.object.push_back(kv);
+                continue;
+            }
+
+            json_value samples;
+            samples.kind = json_value::array_v;
+            std::vector<double> values;
+            for (auto & record : p.records)
+            {
+                const json_value * v = record.find(kv.first);
+                if (v && v->kind == json_value::number_v)
+                {
+                    values.push_back(v->number);
+                    samples.array.push_back(*v);
+                }
+            }
+            sample_stats s = summarize(values);
+
+            json_value m;
+            m.kind = json_value::object_v;
+            m.object.emplace_back("median", make_number(s.median));
+            m.object.emplace_back("mean", make_number(s.mean));
+            m.object.emplace_back("stddev", make_number(s.stddev));
+            m.object.emplace_back("ci95_low", make_number(s.ci95_low));
+            m.object.emplace_back("ci95_high", make_number(s.ci95_high));
+            m.object.emplace_back("min", make_number(s.min));
+            m.object.emplace_back("max", make_number(s.max));
+            m.object.emplace_back("samples", std::move(samples));
+            metrics.object.emplace_back(kv.first, std::move(m));
+        }
+    }
+    out.object.emplace_back("metrics", std::move(metrics));
+    return out;
+}
+
+// Rewritten after each round, so interrupted sweep keeps completed rounds
+bool write_results(const char * path, const std::vector<point> & points)
+{
+    std::string tmp = std::string(path) + ".tmp";
+    FILE * f = fopen(tmp.c_str(), "w");
+    if (!f)
+    {
+        perror(tmp.c_str());
+        return false;
+    }
+    for (auto & p : points)
+    {
+        std::string line;
+        json_write(line, summarize_point(p));
+        line += '\n';
+        fputs(line.c_str(), f);
+    }
+    if (fclose(f) != 0 || rename(tmp.c_str(), path) == -1)
+    {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+void matrix_usage(const char * prog)
+{
+    fprintf(stderr, "Usage: %s run [-k repeat] [-o results.jsonl] [-n] [-v] <matrix>\n", prog);
+    fprintf(stderr, "  [-k repeat] (repetitions of each point, overrides matrix repeat)\n");
+    fprintf(stderr, "  [-o file] (consolidated results, JSON Lines, default results.jsonl)\n");
+    fprintf(stderr, "  [-n] (print commands, run nothing)\n");
+    fprintf(stderr, "  [-v] (pass benchmark stderr through)\n");
+}
+
+} // namespace
+
+int matrix_main(int argc, char ** argv)
+{
+    const char * output = "results.jsonl";
+    int repeat = 0;
+    bool dry_run = false;
+    bool verbose = false;
+    int c;
+
+    while ((c = getopt(argc, argv, "k:o:nvh")) != -1)
+    {
+        switch (c)
+        {
+            case 'k':
+                repeat = atoi(optarg);
+                if (repeat <= 0)
+                {
+                    fprintf(stderr, "Invalid repeat\n");
+                    return 2;
+                }
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'n':
+                dry_run = true;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                matrix_usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind + 1 != argc)
+    {
+        matrix_usage(argv[0]);
+        return 2;
+    }
+
+    matrix m;
+    if (!matrix_load(argv[optind], m))
+    {
+        return 2;
+    }
+    if (repeat)
+    {
+        m.repeat = repeat;
+    }
+    std::vector<point> points = matrix_points(m);
+
+    if (dry_run)
+    {
+        for (auto & p : points)
+        {
+            printf("%s\n", join(p.command).c_str());
+        }
+        fprintf(stderr, "%zu points x %d repetitions\n", points.size(), m.repeat);
+        return 0;
+    }
+
+    // Round-robin over points, so slow drift of the machine is spread over all points instead of biasing some
+    int failed = 0;
+    for (int round = 1; round <= m.repeat; ++round)
+    {
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            point & p = points[i];
+            std::string out;
+            uint64_t start_ns = nb_time_ns();
+            int status = run_process(p.command, m.timeout, verbose, out);
+            double elapsed = (double)(nb_time_ns() - start_ns) / 1e9;
+
+            json_value record;
+            if (status == 0 && parse_record(out, record))
+            {
+                p.records.push_back(std::move(record));
+                fprintf(stderr, "[%d/%d] %zu/%zu %s: %.1f s\n", round, m.repeat, i + 1, points.size(), p.name.c_str(), elapsed);
+            }
+            else
+            {
+                char reason[64];
+                if (status == -1)
+                {
+                    snprintf(reason, sizeof(reason), "timeout");
+                }
+                else if (status != 0)
+                {
+                    snprintf(reason, sizeof(reason), "exit status %d", status);
+                }
+                else
+                {
+                    snprintf(reason, sizeof(reason), "no result record");
+                }
+                ++p.failed;
+                ++failed;
+                fprintf(stderr, "[%d/%d] %zu/%zu %s: failed, %s\n", round, m.repeat, i + 1, points.size(), p.name.c_str(), reason);
+            }
+        }
+        if (!write_results(output, points))
+        {
+            return 2;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+//
+// nb_bench.cpp
+// ~~~~~~~~~~~~
+//
+// Benchmark driver: runs netbench binaries with --format=json and processes their result records.
+//
+
+#include <cstdio>
+#include <cstring>
+
+#include "commands.hpp"
+
+static void usage(const char * prog)
+{
+    fprintf(stderr, "Usage: %s <command> [options]\n", prog);
+    fprintf(stderr, "  run [-k repeat] [-o results.jsonl] [-n] [-v] <matrix> (run matrix of configurations with repetitions)\n");
+    fprintf(stderr, "  compare [-t threshold] [-a alpha] [-m metrics] <baseline> <current> (Mann-Whitney per configuration)\n");
+    fprintf(stderr, "  launch [-c clients] [-t timeout] [-o file] -s <server command> <client command> (server and clients in processes)\n");
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (strcmp(argv[1], "run") == 0)
+    {
+        return matrix_main(argc - 1, argv + 1);
+    }
+    if (strcmp(argv[1], "compare") == 0)
+    {
+        return compare_main(argc - 1, argv + 1);
+    }
+    if (strcmp(argv[1], "launch") == 0)
+    {
+        return launch_main(argc - 1, argv + 1);
+    }
+    usage(argv[0]);
+    return 2;
+}
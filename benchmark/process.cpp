@@ -0,0 +1,249 @@
+//
+// process.cpp
+// ~~~~~~~~~~~
+//
+// Benchmark child processes: start with captured stdout, collect with deadline, wait.
+//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <netbench/clock.h>
+
+#include "process.hpp"
+
+bool process_start(child_process & p, const std::vector<std::string> & command, bool capture, bool verbose, int pass_fd)
+{
+    // close-on-exec, so children started later do not hold write ends of each other
+    int fds[2] = {-1, -1};
+    if (capture && pipe2(fds, O_CLOEXEC) == -1)
+    {
+        perror("pipe");
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        perror("fork");
+        if (capture)
+        {
+            close(fds[0]);
+            close(fds[1]);
+        }
+        return false;
+    }
+    if (pid == 0)
+    {
+        int null_fd = open("/dev/null", O_RDWR);
+        dup2(null_fd, STDIN_FILENO);
+        if (!verbose)
+        {
+            dup2(null_fd, STDERR_FILENO);
+        }
+        dup2(capture ? fds[1] : STDERR_FILENO, STDOUT_FILENO);
+        close(null_fd);
+        if (pass_fd == 3)
+        {
+            fcntl(3, F_SETFD, 0);
+        }
+        else if (pass_fd != -1)
+        {
+            dup2(pass_fd, 3);
+        }
+
+        std::vector<char *> argv;
+        for (auto & arg : command)
+        {
+            argv.push_back(const_cast<char *>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    if (capture)
+    {
+        close(fds[1]);
+    }
+    p.pid = pid;
+    p.out_fd = fds[0];
+    p.output.clear();
+    return true;
+}
+
+bool process_collect(const std::vector<child_process *> & children, uint64_t deadline_ns)
+{
+    bool timed_out = false;
+    for (;;)
+    {
+        std::vector<pollfd> pfds;
+        std::vector<child_process *> readers;
+        for (auto * p : children)
+        {
+            if (p->out_fd != -1)
+            {
+                pfds.push_back(pollfd{p->out_fd, POLLIN, 0});
+                readers.push_back(p);
+            }
+        }
+        if (pfds.empty())
+        {
+            break;
+        }
+
+        int wait_ms = -1;
+        if (deadline_ns)
+        {
+            uint64_t now = nb_time_ns();
+            if (now >= deadline_ns)
+            {
+                timed_out = true;
+                break;
+            }
+            wait_ms = static_cast<int>((deadline_ns - now) / 1000000) + 1;
+        }
+        int ready = poll(pfds.data(), pfds.size(), wait_ms);
+        if (ready <= 0)
+        {
+            continue;
+        }
+        for (size_t i = 0; i < pfds.size(); ++i)
+        {
+            if (pfds[i].revents == 0)
+            {
+                continue;
+            }
+            char buf[4096];
+            ssize_t n = read(pfds[i].fd, buf, sizeof(buf));
+            if (n == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                close(readers[i]->out_fd);
+                readers[i]->out_fd = -1;
+                continue;
+            }
+            readers[i]->output.append(buf, static_cast<size_t>(n));
+        }
+    }
+    if (timed_out)
+    {
+        for (auto * p : children)
+        {
+            if (p->out_fd != -1)
+            {
+                close(p->out_fd);
+                p->out_fd = -1;
+                kill(p->pid, SIGKILL);
+            }
+        }
+    }
+    return !timed_out;
+}
+
+static int exit_status(int status)
+{
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+int process_wait(child_process & p)
+{
+    int status;
+    while (waitpid(p.pid, &status, 0) == -1 && errno == EINTR)
+    {
+    }
+    p.pid = -1;
+    return exit_status(status);
+}
+
+int process_wait(child_process & p, int timeout_ms)
+{
+    uint64_t deadline_ns = nb_time_ns() + static_cast<uint64_t>(timeout_ms) * 1000000;
+    for (;;)
+    {
+        int status;
+        pid_t pid = waitpid(p.pid, &status, WNOHANG);
+        if (pid == p.pid)
+        {
+            p.pid = -1;
+            return exit_status(status);
+        }
+        if (pid == -1 && errno != EINTR)
+        {
+            perror("waitpid");
+            return -1;
+        }
+        if (nb_time_ns() >= deadline_ns)
+        {
+            kill(p.pid, SIGKILL);
+            return process_wait(p);
+        }
+        usleep(10000);
+    }
+}
+
+int run_process(const std::vector<std::string> & command, int timeout, bool verbose, std::string & output)
+{
+    child_process p;
+    if (!process_start(p, command, true, verbose))
+    {
+        return -1;
+    }
+    uint64_t deadline_ns = timeout ? nb_time_ns() + static_cast<uint64_t>(timeout) * 1000000000 : 0;
+    bool completed = process_collect({&p}, deadline_ns);
+    int status = process_wait(p);
+    output = std::move(p.output);
+    return completed ? status : -1;
+}
+
+bool parse_record(const std::string & output, json_value & record)
+{
+    std::istringstream in(output);
+    std::string line;
+    bool found = false;
+    while (std::getline(in, line))
+    {
+        json_value v;
+        if (!line.empty() && line[0] == '{' && json_parser(line).parse(v) && v.kind == json_value::object_v)
+        {
+            record = std::move(v);
+            found = true;
+        }
+    }
+    return found;
+}
+
+std::vector<std::string> split(const std::string & line)
+{
+    std::vector<std::string> words;
+    std::istringstream in(line);
+    std::string w;
+    while (in >> w)
+    {
+        words.push_back(w);
+    }
+    return words;
+}
+
+std::string join(const std::vector<std::string> & words)
+{
+    std::string s;
+    for (auto & w : words)
+    {
+        if (!s.empty())
+        {
+            s += ' ';
+        }
+        s += w;
+    }
+    return s;
+}
@@ -0,0 +1,44 @@
+#ifndef _PROCESS_HPP
+#define _PROCESS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "json.hpp"
+
+// Benchmark child process, stdin is /dev/null, stderr is discarded unless verbose
+struct child_process
+{
+    pid_t pid = -1;
+    int out_fd = -1; // stdout pipe until EOF, -1 if not captured
+    std::string output;
+};
+
+// Start command with captured stdout (otherwise it goes where stderr goes), pass_fd is inherited as fd 3 (-1 - none).
+// Exit status is 127 if command can not be executed. Return false on pipe or fork error.
+bool process_start(child_process & p, const std::vector<std::string> & command, bool capture, bool verbose, int pass_fd = -1);
+
+// Collect stdout of children until EOF of all, children still running at deadline (nb_time_ns, 0 - none) are killed.
+// Return false on timeout.
+bool process_collect(const std::vector<child_process *> & children, uint64_t deadline_ns);
+
+// Wait for exit, return exit status or 128 + signal
+int process_wait(child_process & p);
+
+// Wait up to timeout_ms for exit, then kill. Return exit status or 128 + signal
+int process_wait(child_process & p, int timeout_ms);
+
+// Run command and collect stdout. Return exit status, -1 on timeout (s, 0 - none, process is killed) or pipe/fork error.
+int run_process(const std::vector<std::string> & command, int timeout, bool verbose, std::string & output);
+
+// Last JSON object line of benchmark output
+bool parse_record(const std::string & output, json_value & record);
+
+std::vector<std::string> split(const std::string & line);
+
+std::string join(const std::vector<std::string> & words);
+
+#endif /* _PROCESS_HPP */
@@ -0,0 +1,192 @@
+//
+// results.cpp
+// ~~~~~~~~~~~
+//
+// Result sets of benchmark records and nb_bench run summaries.
+//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "results.hpp"
+
+namespace
+{
+
+// Fields of benchmark records which describe configuration
+const char * const config_keys[] = {
+    "block_size",
+    "depth",
+    "sessions",
+    "threads",
+    "servers",
+    "duration_s",
+    "warmup_s",
+    "pipes",
+    "active",
+    "writes",
+    "runs",
+    "port",
+    "content_length",
+    "client_process",
+    "client_processes",
+};
+
+// Fields added by nb_bench run, not part of configuration
+const char * const summary_keys[] = {
+    "point",
+    "command",
+    "repeat",
+    "failed",
+    "metrics",
+};
+
+bool contains(const char * const * keys, size_t count, const std::string & key)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (key == keys[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string value_string(const json_value & v)
+{
+    if (v.kind == json_value::string_v)
+    {
+        return v.string;
+    }
+    std::string s;
+    json_write(s, v);
+    return s;
+}
+
+} // namespace
+
+bool is_metric(const std::string & key, const json_value & value)
+{
+    if (value.kind != json_value::number_v && value.kind != json_value::null_v)
+    {
+        return false;
+    }
+    return !contains(config_keys, sizeof(config_keys) / sizeof(config_keys[0]), key);
+}
+
+std::vector<double> * result_point::metric(const std::string & name)
+{
+    for (auto & m : metrics)
+    {
+        if (m.first == name)
+        {
+            return &m.second;
+        }
+    }
+    metrics.emplace_back(name, std::vector<double>());
+    return &metrics.back().second;
+}
+
+const std::vector<double> * result_point::find_metric(const std::string & name) const
+{
+    for (auto & m : metrics)
+    {
+        if (m.first == name)
+        {
+            return &m.second;
+        }
+    }
+    return nullptr;
+}
+
+result_point * result_set::find(const std::string & key)
+{
+    for (auto & p : points)
+    {
+        if (p.key == key)
+        {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+bool results_load(const char * path, result_set & set)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+    std::string line;
+    int lineno = 0;
+    while (std::getline(in, line))
+    {
+        ++lineno;
+        if (line.empty() || line[0] != '{')
+        {
+            continue;
+        }
+        json_value record;
+        if (!json_parser(line).parse(record) || record.kind != json_value::object_v)
+        {
+            fprintf(stderr, "%s:%d: invalid record\n", path, lineno);
+            return false;
+        }
+
+        std::string key;
+        for (auto & kv : record.object)
+        {
+            if (is_metric(kv.first, kv.second) || contains(summary_keys, sizeof(summary_keys) / sizeof(summary_keys[0]), kv.first))
+            {
+                continue;
+            }
+            if (!key.empty())
+            {
+                key += ' ';
+            }
+            key += kv.first + "=" + value_string(kv.second);
+        }
+
+        result_point * p = set.find(key);
+        if (!p)
+        {
+            set.points.emplace_back();
+            p = &set.points.back();
+            p->key = key;
+            const json_value * point = record.find("point");
+            p->label = point && point->kind == json_value::string_v ? point->string : key;
+        }
+
+        const json_value * metrics = record.find("metrics");
+        if (metrics && metrics->kind == json_value::object_v)
+        {
+            // nb_bench run summary
+            for (auto & m : metrics->object)
+            {
+                const json_value * samples = m.second.find("samples");
+                std::vector<double> * values = p->metric(m.first);
+                for (size_t i = 0; samples && i < samples->array.size(); ++i)
+                {
+                    if (samples->array[i].kind == json_value::number_v)
+                    {
+                        values->push_back(samples->array[i].number);
+                    }
+                }
+            }
+            continue;
+        }
+        for (auto & kv : record.object)
+        {
+            if (is_metric(kv.first, kv.second) && kv.second.kind == json_value::number_v)
+            {
+                p->metric(kv.first)->push_back(kv.second.number);
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef _RESULTS_HPP
+#define _RESULTS_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json.hpp"
+
+// Metric samples of one configuration
+struct result_point
+{
+    std::string key; // configuration fields, same for benchmark records and nb_bench run summaries
+    std::string label; // nb_bench point name, key for benchmark records
+    std::vector<std::pair<std::string, std::vector<double>>> metrics; // in record order
+
+    // samples of metric, added if missing
+    std::vector<double> * metric(const std::string & name);
+    const std::vector<double> * find_metric(const std::string & name) const;
+};
+
+struct result_set
+{
+    std::vector<result_point> points; // in file order
+
+    result_point * find(const std::string & key);
+};
+
+// Numeric fields are metrics, except known configuration fields (block_size, sessions, ...)
+bool is_metric(const std::string & key, const json_value & value);
+
+// Load JSON Lines of benchmark records (--format=json, records of same configuration are repetitions)
+// or nb_bench run summaries (samples of metrics). Print error and return false on invalid file.
+bool results_load(const char * path, result_set & set);
+
+#endif /* _RESULTS_HPP */
@@ -0,0 +1,205 @@
+#ifndef _SAMPLE_STATS_HPP
+#define _SAMPLE_STATS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Summary of metric repetitions
+struct sample_stats
+{
+    size_t count = 0;
+    double min = 0;
+    double max = 0;
+    double median = 0;
+    double mean = 0;
+    double stddev = 0; // sample standard deviation, 0 for single sample
+    double ci95_low = 0; // 95% confidence interval of mean (Student t)
+    double ci95_high = 0;
+};
+
+// Two-sided 0.975 quantile of Student t distribution, normal approximation above 30 degrees of freedom
+inline double student_t975(size_t df)
+{
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df == 0)
+    {
+        return 0;
+    }
+    if (df <= sizeof(table) / sizeof(table[0]))
+    {
+        return table[df - 1];
+    }
+    return 1.960;
+}
+
+inline sample_stats summarize(std::vector<double> samples)
+{
+    sample_stats s;
+    s.count = samples.size();
+    if (samples.empty())
+    {
+        return s;
+    }
+    std::sort(samples.begin(), samples.end());
+    s.min = samples.front();
+    s.max = samples.back();
+    size_t mid = samples.size() / 2;
+    s.median = samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2;
+
+    double sum = 0;
+    for (double v : samples)
+    {
+        sum += v;
+    }
+    s.mean = sum / (double)samples.size();
+
+    if (samples.size() > 1)
+    {
+        double sq = 0;
+        for (double v : samples)
+        {
+            sq += (v - s.mean) * (v - s.mean);
+        }
+        s.stddev = std::sqrt(sq / (double)(samples.size() - 1));
+    }
+    double half = student_t975(samples.size() - 1) * s.stddev / std::sqrt((double)samples.size());
+    s.ci95_low = s.mean - half;
+    s.ci95_high = s.mean + half;
+    return s;
+}
+
+// Exact distribution of Mann-Whitney U for sample sizes m and n without ties, counts of each U in [0, m * n]
+inline std::vector<double> mann_whitney_counts(size_t m, size_t n)
+{
+    // dist[i][j] - counts for sizes i and j, dist[i][j][u] = dist[i - 1][j][u - j] + dist[i][j - 1][u]
+    std::vector<std::vector<std::vector<double>>> dist(m + 1, std::vector<std::vector<double>>(n + 1));
+    for (size_t i = 0; i <= m; ++i)
+    {
+        for (size_t j = 0; j <= n; ++j)
+        {
+            std::vector<double> & d = dist[i][j];
+            d.assign(i * j + 1, 0);
+            if (i == 0 || j == 0)
+            {
+                d[0] = 1;
+                continue;
+            }
+            for (size_t u = 0; u <= i * j; ++u)
+            {
+                if (u >= j && u - j < dist[i - 1][j].size())
+                {
+                    d[u] += dist[i - 1][j][u - j];
+                }
+                if (u < dist[i][j - 1].size())
+                {
+                    d[u] += dist[i][j - 1][u];
+                }
+            }
+        }
+    }
+    return dist[m][n];
+}
+
+// Smallest two-sided p-value the exact Mann-Whitney U test can give for sizes m and n (complete separation)
+inline double mann_whitney_min_p(size_t m, size_t n)
+{
+    double orderings = 1; // C(m + n, m)
+    for (size_t i = 1; i <= m; ++i)
+    {
+        orderings = orderings * (double)(n + i) / (double)i;
+    }
+    return std::min(1.0, 2 / orderings);
+}
+
+// Two-sided p-value of Mann-Whitney U test (are a and b from the same distribution).
+// Exact for small samples without ties, normal approximation with tie and continuity correction otherwise.
+inline double mann_whitney_p(const std::vector<double> & a, const std::vector<double> & b)
+{
+    size_t m = a.size();
+    size_t n = b.size();
+    if (m == 0 || n == 0)
+    {
+        return 1;
+    }
+
+    // ranks of pooled samples, ties get average rank
+    std::vector<std::pair<double, bool>> pooled; // value, from a
+    for (double v : a)
+    {
+        pooled.emplace_back(v, true);
+    }
+    for (double v : b)
+    {
+        pooled.emplace_back(v, false);
+    }
+    std::sort(pooled.begin(), pooled.end());
+    double rank_sum = 0; // of a
+    double tie_term = 0; // sum of t^3 - t over tie groups
+    bool ties = false;
+    for (size_t i = 0; i < pooled.size();)
+    {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first)
+        {
+            ++j;
+        }
+        double t = (double)(j - i);
+        double rank = (double)(i + j + 1) / 2; // average of ranks i + 1 .. j
+        for (size_t k = i; k < j; ++k)
+        {
+            if (pooled[k].second)
+            {
+                rank_sum += rank;
+            }
+        }
+        if (t > 1)
+        {
+            ties = true;
+            tie_term += t * t * t - t;
+        }
+        i = j;
+    }
+    double u = rank_sum - (double)m * (double)(m + 1) / 2;
+
+    if (!ties && m * n <= 400)
+    {
+        std::vector<double> counts = mann_whitney_counts(m, n);
+        double total = 0;
+        double below = 0; // P(U <= u)
+        double above = 0; // P(U >= u)
+        for (size_t k = 0; k < counts.size(); ++k)
+        {
+            total += counts[k];
+            if ((double)k <= u)
+            {
+                below += counts[k];
+            }
+            if ((double)k >= u)
+            {
+                above += counts[k];
+            }
+        }
+        return std::min(1.0, 2 * std::min(below, above) / total);
+    }
+
+    double size = (double)(m + n);
+    double mean = (double)m * (double)n / 2;
+    double variance = (double)m * (double)n / 12 * ((size + 1) - tie_term / (size * (size - 1)));
+    if (variance <= 0)
+    {
+        return 1;
+    }
+    double z = (std::fabs(u - mean) - 0.5) / std::sqrt(variance);
+    if (z < 0)
+    {
+        z = 0;
+    }
+    return std::min(1.0, std::erfc(z / std::sqrt(2.0)));
+}
+
+#endif /* _SAMPLE_STATS_HPP */
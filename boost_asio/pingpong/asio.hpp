@@ -1,3 +1,9 @@
+#ifndef _ASIO_HPP
+#define _ASIO_HPP
+
+// boost/asio/awaitable.hpp (boost < 1.75) uses std::exchange without <utility>
+#include <utility>
+
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 
@@ -5,4 +11,27 @@ namespace asio
 {
   using namespace boost::asio;
   using boost::system::error_code;
+
+  // SO_REUSEPORT socket option, not provided by asio
+  typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+
+  // Reactor/proactor, selected by boost config at build time
+  inline const char * backend_name()
+  {
+#if defined(BOOST_ASIO_HAS_IO_URING) && !defined(BOOST_ASIO_HAS_EPOLL)
+    return "io_uring";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+    return "epoll";
+#elif defined(BOOST_ASIO_HAS_KQUEUE)
+    return "kqueue";
+#elif defined(BOOST_ASIO_HAS_IOCP)
+    return "iocp";
+#elif defined(BOOST_ASIO_HAS_DEV_POLL)
+    return "/dev/poll";
+#else
+    return "select";
+#endif
+  }
 }
+
+#endif /* _ASIO_HPP */
@@ -11,6 +11,7 @@
 #include "pch.h" // precompiled header, add other headers after
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <list>
 #include <string>
@@ -19,125 +20,496 @@
 #include <boost/bind.hpp>
 #include <boost/mem_fn.hpp>
 
+#include <chrono>
+#include <thread>
+
+#include <getopt.h>
 #ifndef WIN32
 #    include <sys/resource.h>
 #endif
 
+#include <netbench/affinity.h>
+#include <netbench/cputime.h>
+#include <netbench/clock.h>
+#include <netbench/frame.h>
+#include <netbench/histogram.h>
+#include <netbench/inflight.h>
+#include <netbench/perf.h>
+#include <netbench/ready.h>
+#include <netbench/report.h>
+#include <netbench/result.h>
+#include <netbench/sizes.h>
+#include <netbench/stats.h>
+#include <netbench/verify.h>
+
 #include "server.hpp"
 
+struct client_options
+{
+    size_t block_size; // max payload size
+    const nb_sizes * sizes; // payload size distribution
+    std::string sizes_spec;
+    size_t depth; // messages in flight per session
+    double rate; // open-loop messages/s for all sessions, 0 for closed-loop
+    bool framed; // length-prefixed frames
+    bool verify; // stamp messages with sequence and CRC32C, check echo
+    size_t session_count;
+    size_t thread_count;
+    int timeout; // measurement duration, s
+    int warmup; // excluded from stats, s
+    double interval; // interval reports period, s (0 - disabled)
+    handler_alloc handler_mode; // handler memory: asio default allocator, heap per operation or recycled block
+    const nb_cpus * cpus; // client threads placement
+    nb_perf * perf; // client threads hardware counters
+    nb_cputime * cputime; // client threads CPU time
+    std::string cpus_spec;
+    nb_format format; // result output format
+};
+
+static const char * engine_name()
+{
+#if defined(ASIO_PP_CORO)
+    return "asio_pp_coro";
+#elif defined(BOOST_ASIO_HAS_IO_URING) && !defined(BOOST_ASIO_HAS_EPOLL)
+    return "asio_pp_uring";
+#else
+    return "asio_pp";
+#endif
+}
+
 class stats
 {
 public:
-    stats(size_t block_size, int timeout)
-        : mutex_()
-        , total_bytes_written_(0)
-        , total_bytes_read_(0)
-        , total_reads_(0)
-        , total_writes_(0)
-        , block_size_(block_size)
-        , session_count_(0)
-        , total_errors_(0)
-        , timeout_(timeout)
+    // server, server_perf and server_cputime are nullptr for external server
+    stats(const client_options & options, const server_group * server, nb_perf * server_perf, nb_cputime * server_cputime)
+        : options_(options)
+        , server_(server)
+        , server_threads_(server ? server->size() : 0)
+        , server_perf_(server_perf)
+        , server_cputime_(server_cputime)
+        , server_allocations_(0)
     {
+        if (nb_stats_init(&stats_, options.thread_count) == -1)
+        {
+            throw std::bad_alloc();
+        }
     }
 
-    void add(size_t bytes_written, size_t bytes_read, size_t writes, size_t reads)
+    ~stats() { nb_stats_free(&stats_); }
+
+    // per-thread counters, must be updated only from one thread
+    nb_stats_slot * slot(size_t idx) { return nb_stats_get_slot(&stats_, idx); }
+
+    // Wait for warmup, then measure for timeout (steady clock) with optional interval reports.
+    // Sessions run in other threads and are stopped by caller after return.
+    void measure()
     {
-        if (reads > 0)
+        std::this_thread::sleep_for(std::chrono::seconds(options_.warmup));
+
+        nb_stats_window window;
+        nb_stats_window interval;
+        nb_stats_window_start(&window, &stats_);
+        nb_perf_values client_perf_start;
+        nb_perf_values server_perf_start;
+        nb_cputime_values client_cputime_start;
+        nb_cputime_values server_cputime_start;
+        nb_perf_read(options_.perf, &client_perf_start);
+        nb_cputime_read(options_.cputime, &client_cputime_start);
+        uint64_t server_allocations_start = 0;
+        if (server_perf_)
+        {
+            nb_perf_read(server_perf_, &server_perf_start);
+            nb_cputime_read(server_cputime_, &server_cputime_start);
+            server_allocations_start = server_->handler_allocations();
+        }
+        interval = window;
+
+        uint64_t end_ns = window.start_ns + static_cast<uint64_t>(options_.timeout) * 1000000000;
+        uint64_t interval_ns = static_cast<uint64_t>(options_.interval * 1e9);
+        // keep stdout for result record in machine-readable formats
+        FILE * report_out = options_.format == NB_FORMAT_TABLE ? stdout : stderr;
+        if (interval_ns)
         {
-            asio::detail::mutex::scoped_lock lock(mutex_);
-            total_bytes_written_ += bytes_written;
-            total_bytes_read_ += bytes_read;
-            total_writes_ += writes;
-            total_reads_ += reads;
-            ++session_count_;
+            nb_report_interval_header(report_out);
+        }
+        for (;;)
+        {
+            uint64_t now = nb_time_ns();
+            if (now >= end_ns)
+            {
+                break;
+            }
+            uint64_t wake_ns = end_ns;
+            if (interval_ns && interval.start_ns + interval_ns < wake_ns)
+            {
+                wake_ns = interval.start_ns + interval_ns;
+            }
+            std::this_thread::sleep_for(std::chrono::nanoseconds(wake_ns - now));
+            if (interval_ns && nb_time_ns() >= interval.start_ns + interval_ns)
+            {
+                nb_counters c;
+                nb_histogram latency;
+                uint64_t elapsed_ns = nb_stats_window_next(&interval, &stats_, &c, &latency);
+                nb_report_interval(report_out, interval.start_ns - window.start_ns, elapsed_ns, &c, &latency);
+            }
+        }
+
+        elapsed_ns_ = nb_stats_window_get(&window, &stats_, &counters_, &latency_);
+        nb_perf_values perf_end;
+        nb_cputime_values cputime_end;
+        nb_perf_read(options_.perf, &perf_end);
+        nb_perf_diff(&client_perf_, &perf_end, &client_perf_start);
+        nb_cputime_read(options_.cputime, &cputime_end);
+        nb_cputime_diff(&client_cputime_, &cputime_end, &client_cputime_start);
+        if (server_perf_)
+        {
+            nb_perf_read(server_perf_, &perf_end);
+            nb_perf_diff(&server_perf_values_, &perf_end, &server_perf_start);
+            nb_cputime_read(server_cputime_, &cputime_end);
+            nb_cputime_diff(&server_cputime_values_, &cputime_end, &server_cputime_start);
+            server_allocations_ = server_->handler_allocations() - server_allocations_start;
         }
     }
 
-    void print()
+    // configuration and stats of measure()
+    void result(nb_result * r)
     {
-        asio::detail::mutex::scoped_lock lock(mutex_);
-
-        printf(
-            "%20s %8s %6s %18s %18s %10s %12s %18s %18s\n",
-            "Write buffer (bytes)",
-            "Clients",
-            "Errors",
-            "Avg messages size",
-            "Throughtput: MiB/s",
-            "Msg/s",
-            "us/msg",
-            "Total read: bytes",
-            "messages");
-        printf(
-            "%20zd %8zd %6zd %18.3f %18.3f %10ld %12.3f %18zd %18zd\n",
-            block_size_,
-            session_count_,
-            total_errors_,
-            (double)total_bytes_read_ / total_reads_,
-            (double)total_bytes_read_ / (timeout_ * 1024 * 1024),
-            total_reads_ / timeout_,
-            (double)100000 * timeout_ / total_reads_,
-            total_bytes_read_,
-            total_reads_);
+        // latency of open-loop is measured from scheduled send time
+        char rate[32];
+        if (options_.rate > 0)
+        {
+            snprintf(rate, sizeof(rate), "%.0f", options_.rate);
+        }
+        else
+        {
+            snprintf(rate, sizeof(rate), "closed");
+        }
+
+        nb_result_str(r, "engine", "Engine", engine_name());
+        nb_result_str(r, "backend", "Backend", asio::backend_name());
+        nb_result_str(r, "handler", "Handler", handler_mode());
+        nb_result_int(r, "block_size", "Write buffer (bytes)", (int64_t)options_.block_size);
+        nb_result_str(r, "sizes", "Sizes", options_.sizes_spec.c_str());
+        nb_result_int(r, "depth", "Depth", (int64_t)options_.depth);
+        nb_result_str(r, "rate", "Rate/s", rate);
+        nb_result_str(r, "framing", "Framing", options_.framed ? "frame" : "stream");
+        nb_result_str(r, "verify", "Verify", options_.verify ? nb_crc32c_impl() : "off");
+        nb_result_int(r, "sessions", "Sessions", (int64_t)options_.session_count);
+        nb_result_int(r, "threads", "Threads", (int64_t)options_.thread_count);
+        nb_result_int(r, "servers", "Servers", (int64_t)server_threads_);
+        nb_result_int(r, "duration_s", "Duration: s", options_.timeout);
+        nb_result_int(r, "warmup_s", "Warmup: s", options_.warmup);
+
+        char nodes[64];
+        nb_cpus_nodes(options_.cpus, options_.thread_count, nodes, sizeof(nodes));
+        nb_result_str(r, "client_cpus", "Client CPUs", options_.cpus_spec.empty() ? "-" : options_.cpus_spec.c_str());
+        nb_result_str(r, "client_nodes", "Client nodes", nodes);
+
+        nb_result_metrics(r, elapsed_ns_, &counters_, &latency_);
+        // asio default allocator is not counted
+        nb_result_double(r, "allocs_per_msg", "Allocs/msg", allocs_per_msg(counters_.allocations), 3);
+        if (server_)
+        {
+            nb_result_double(r, "server_allocs_per_msg", "Server allocs/msg", allocs_per_msg(server_allocations_), 3);
+        }
+        nb_result_cputime(r, "client", &client_cputime_, elapsed_ns_, (double)counters_.messages);
+        if (server_cputime_)
+        {
+            nb_result_cputime(r, "server", &server_cputime_values_, elapsed_ns_, (double)counters_.messages);
+        }
+        if (options_.perf->enabled)
+        {
+            nb_result_perf(r, "client", options_.perf, &client_perf_, (double)counters_.messages, "msg");
+            if (server_perf_)
+            {
+                nb_result_perf(r, "server", server_perf_, &server_perf_values_, (double)counters_.messages, "msg");
+            }
+        }
     }
 
 private:
-    asio::detail::mutex mutex_;
-    size_t total_bytes_written_;
-    size_t total_bytes_read_;
-    size_t total_writes_;
-    size_t total_reads_;
-    size_t block_size_;
-    size_t session_count_;
-    size_t total_errors_;
-    int timeout_;
+    const char * handler_mode() const
+    {
+#if defined(ASIO_PP_CORO)
+        return "coro";
+#else
+        return handler_alloc_name(options_.handler_mode);
+#endif
+    }
+
+    double allocs_per_msg(uint64_t allocations) const
+    {
+#if defined(ASIO_PP_CORO)
+        // coroutine frames and handlers are allocated by asio, not counted
+        (void)allocations;
+        return NAN;
+#endif
+        if (options_.handler_mode == handler_alloc::asio || counters_.messages == 0)
+        {
+            return NAN;
+        }
+        return static_cast<double>(allocations) / static_cast<double>(counters_.messages);
+    }
+
+    nb_stats stats_;
+    client_options options_;
+    const server_group * server_;
+    size_t server_threads_; // 0 for external server
+    nb_perf * server_perf_;
+    nb_cputime * server_cputime_;
+    // measurement window results
+    nb_counters counters_;
+    nb_histogram latency_;
+    uint64_t elapsed_ns_;
+    nb_perf_values client_perf_;
+    nb_perf_values server_perf_values_;
+    nb_cputime_values client_cputime_;
+    nb_cputime_values server_cputime_values_;
+    uint64_t server_allocations_;
 };
 
+// Keeps up to depth messages (payload size from distribution, with frame header in framed mode) in flight, reads and writes are independent,
+// responses are matched to requests in order by received bytes count.
+// In open-loop mode messages are sent by timetable (depth limits outstanding messages) and latency is measured
+// from scheduled send time, so client-side queueing behind a stalled server is counted (coordinated omission correction).
 class client_session
 {
 public:
-    client_session(asio::io_service & io_service, size_t block_size, stats & s)
+    // index - over all client threads, seeds payload sizes
+    client_session(asio::io_service & io_service, const client_options & options, size_t index, nb_stats_slot * slot)
         : io_service_(io_service)
         , socket_(io_service_)
-        , block_size_(block_size)
-        , data_(new char[block_size])
-        // , read_data_length_(0)
-        // , write_data_(new char[block_size])
-        , writes_(0)
-        , reads_(0)
-        , bytes_written_(0)
-        , bytes_read_(0)
-        , stats_(s)
+        , header_size_(options.framed ? NB_FRAME_HEADER_SIZE : 0)
+        , max_message_size_(header_size_ + options.block_size)
+        , sizes_(options.sizes)
+        , sizes_state_(nb_sizes_seed(index + 1))
+        , write_data_(new char[max_message_size_ * options.depth])
+        , read_data_(new char[max_message_size_ * options.depth])
+        , stopped_(false)
+        , writing_(false)
+        , interval_ns_(options.rate > 0 ? static_cast<uint64_t>(1e9 * static_cast<double>(options.session_count) / options.rate) : 0)
+        , next_send_ns_(0)
+        , timer_(io_service)
+#if !defined(ASIO_PP_CORO)
+        , timer_armed_(false)
+#endif
+        , verify_(options.verify)
+        , slot_(slot)
+        , read_memory_(options.handler_mode, &slot->counters.allocations)
+        , write_memory_(options.handler_mode, &slot->counters.allocations)
+        , timer_memory_(options.handler_mode, &slot->counters.allocations)
     {
-        for (size_t i = 0; i < block_size_; ++i)
+        for (size_t i = 0; i < max_message_size_ * options.depth; ++i)
         {
-            data_[i] = static_cast<char>(i % 128);
+            write_data_[i] = static_cast<char>(i % 128);
+        }
+        nb_verify_init(&verify_state_);
+        if (nb_inflight_init(&inflight_, options.depth) == -1)
+        {
+            delete[] write_data_;
+            delete[] read_data_;
+            throw std::bad_alloc();
         }
     }
 
-    ~client_session() { delete[] data_; }
+    ~client_session()
+    {
+        nb_inflight_free(&inflight_);
+        delete[] write_data_;
+        delete[] read_data_;
+    }
 
+#if defined(ASIO_PP_CORO)
+    void start(asio::ip::tcp::resolver::iterator endpoint_iterator)
+    {
+        asio::co_spawn(io_service_, run(endpoint_iterator), asio::detached);
+    }
+#else
     void start(asio::ip::tcp::resolver::iterator endpoint_iterator)
     {
         asio::ip::tcp::endpoint endpoint = *endpoint_iterator;
         socket_.async_connect(endpoint, boost::bind(&client_session::handle_connect, this, asio::placeholders::error, ++endpoint_iterator));
     }
+#endif
 
     void stop()
     {
-        stats_.add(bytes_written_, bytes_read_, writes_, reads_);
-
-        bytes_written_ = 0;
-        bytes_read_ = 0;
-        writes_ = 0;
-        reads_ = 0;
+        if (stopped_)
+        {
+            return;
+        }
+        stopped_ = true;
 
+        timer_.cancel();
         close_socket();
     }
 
 private:
-    void handle_connect(const std::error_code & err, asio::ip::tcp::resolver::iterator endpoint_iterator)
+    void handle_error(const asio::error_code & err)
+    {
+        if (!stopped_ && err != asio::error::operation_aborted)
+        {
+            nb_stats_error(slot_);
+        }
+    }
+
+    void close_socket() { socket_.close(); }
+
+    // first open-loop send is at random offset in interval, so sessions don't send in bursts
+    void start_schedule()
+    {
+        next_send_ns_ = nb_time_ns();
+        if (interval_ns_)
+        {
+            next_send_ns_ += sizes_state_ % interval_ns_;
+        }
+    }
+
+    std::chrono::steady_clock::time_point next_send_time() const
+    {
+        // steady_clock and nb_time_ns are CLOCK_MONOTONIC
+        return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(next_send_ns_));
+    }
+
+    // queue messages up to depth (in open-loop mode only already due), return size of write
+    std::size_t fill_inflight()
+    {
+        size_t length = 0;
+        size_t count = 0;
+        uint64_t stamp_ns = 0; // messages are sent together after the batch is stamped
+        uint64_t now = nb_time_ns();
+        while (nb_inflight_space(&inflight_) > 0)
+        {
+            uint64_t start_ns = now;
+            if (interval_ns_)
+            {
+                if (next_send_ns_ > now)
+                {
+                    break;
+                }
+                start_ns = next_send_ns_;
+                next_send_ns_ += interval_ns_;
+            }
+            size_t payload_size = nb_sizes_next(sizes_, &sizes_state_);
+            if (verify_ && payload_size < NB_VERIFY_TRAILER)
+            {
+                payload_size = NB_VERIFY_TRAILER;
+            }
+            if (header_size_)
+            {
+                nb_frame_header_write(write_data_ + length, static_cast<uint32_t>(payload_size));
+            }
+            if (verify_)
+            {
+                uint64_t verify_start = nb_time_ns();
+                nb_verify_stamp(&verify_state_, write_data_ + length, header_size_ + payload_size);
+                uint64_t verify_ns = nb_time_ns() - verify_start;
+                nb_stats_verify(slot_, verify_ns, 0);
+                stamp_ns += verify_ns;
+            }
+            nb_inflight_push(&inflight_, start_ns, header_size_ + payload_size);
+            length += header_size_ + payload_size;
+            ++count;
+        }
+        if (stamp_ns)
+        {
+            nb_inflight_delay(&inflight_, count, stamp_ns);
+        }
+        return length;
+    }
+
+    // account received bytes, return count of completed messages
+    std::size_t read_completed(std::size_t length)
+    {
+        uint64_t now = nb_time_ns();
+        nb_stats_read(slot_, length);
+        if (verify_)
+        {
+            // before ack, it needs sizes of messages in flight, verification time is not counted in latency
+            size_t corrupted = nb_verify_check(&verify_state_, &inflight_, read_data_, length);
+            nb_stats_verify(slot_, nb_time_ns() - now, corrupted);
+        }
+        return nb_inflight_ack(&inflight_, length, now, slot_);
+    }
+
+#if defined(ASIO_PP_CORO)
+    // connect, start writer, then read loop, session state is kept in client_session
+    asio::awaitable<void> run(asio::ip::tcp::resolver::iterator endpoint_iterator)
+    {
+        try
+        {
+            co_await asio::async_connect(socket_, endpoint_iterator, asio::ip::tcp::resolver::iterator(), asio::use_awaitable);
+
+            asio::ip::tcp::no_delay no_delay(true);
+            socket_.set_option(no_delay);
+            nb_stats_session(slot_);
+
+            start_schedule();
+            start_writer();
+            while (!stopped_)
+            {
+                std::size_t length
+                    = co_await socket_.async_read_some(asio::buffer(read_data_, max_message_size_ * inflight_.capacity), asio::use_awaitable);
+                if (stopped_)
+                {
+                    break;
+                }
+                if (read_completed(length) > 0)
+                {
+                    start_writer();
+                }
+            }
+        }
+        catch (const boost::system::system_error & e)
+        {
+            handle_error(e.code());
+        }
+    }
+
+    void start_writer()
+    {
+        if (!writing_)
+        {
+            writing_ = true;
+            asio::co_spawn(io_service_, write_loop(), asio::detached);
+        }
+    }
+
+    // only one write in flight, refill until depth is reached, in open-loop mode sleep until next message is due
+    asio::awaitable<void> write_loop()
+    {
+        try
+        {
+            while (!stopped_)
+            {
+                std::size_t length = fill_inflight();
+                if (length == 0)
+                {
+                    if (interval_ns_ == 0 || nb_inflight_space(&inflight_) == 0)
+                    {
+                        // restarted by reader on ack
+                        break;
+                    }
+                    timer_.expires_at(next_send_time());
+                    co_await timer_.async_wait(asio::use_awaitable);
+                    continue;
+                }
+                std::size_t written = co_await asio::async_write(socket_, asio::buffer(write_data_, length), asio::use_awaitable);
+                if (stopped_)
+                {
+                    break;
+                }
+                nb_stats_write(slot_, written);
+            }
+        }
+        catch (const boost::system::system_error & e)
+        {
+            handle_error(e.code());
+        }
+        writing_ = false;
+    }
+#else
+    void handle_connect(const asio::error_code & err, asio::ip::tcp::resolver::iterator endpoint_iterator)
     {
         if (!err)
         {
@@ -146,7 +518,10 @@ private:
             socket_.set_option(no_delay, set_option_err);
             if (!set_option_err)
             {
-                do_write(block_size_);
+                nb_stats_session(slot_);
+                start_schedule();
+                do_read();
+                do_write();
             }
         }
         else if (endpoint_iterator != asio::ip::tcp::resolver::iterator())
@@ -156,61 +531,109 @@ private:
             socket_.async_connect(
                 endpoint, boost::bind(&client_session::handle_connect, this, asio::placeholders::error, ++endpoint_iterator));
         }
+        else
+        {
+            handle_error(err);
+        }
     }
 
-    void close_socket() { socket_.close(); }
-
     void do_read()
     {
-        socket_.async_read_some(asio::buffer(data_, block_size_), [this](asio::error_code ec, std::size_t length) {
-            if (!ec)
-            {
-                bytes_read_ += length;
-                ++reads_;
-                do_write(length);
-            }
-        });
-        // make_custom_alloc_handler(read_allocator_, [this, self](std::error_code ec, std::size_t length) {
-        //     if (!ec)
-        //     {
-        //         do_write(length);
-        //     }
-        // }));
+        async_with_memory(
+            read_memory_,
+            [this](asio::error_code ec, std::size_t length) {
+                if (!ec && !stopped_)
+                {
+                    if (read_completed(length) > 0)
+                    {
+                        do_write();
+                    }
+                    do_read();
+                }
+                else
+                {
+                    handle_error(ec);
+                }
+            },
+            [this](auto handler) { socket_.async_read_some(asio::buffer(read_data_, max_message_size_ * inflight_.capacity), std::move(handler)); });
     }
 
-    void do_write(std::size_t length)
+    // only one write in flight, messages completed meanwhile are sent by next write
+    void do_write()
     {
-        asio::async_write(socket_, asio::buffer(data_, length), [this](asio::error_code ec, std::size_t written) {
-            if (!ec)
-            {
-                bytes_written_ += written;
-                ++writes_;
-                do_read();
-            }
-        });
-        //make_custom_alloc_handler(write_allocator_, [this, self](std::error_code ec, std::size_t /*length*/) {
-        // [this, self](std::error_code ec, std::size_t /*length*/) {
-        //     if (!ec)
-        //     {
-        //         do_read();
-        //     }
-        // }));
+        if (writing_)
+        {
+            return;
+        }
+        std::size_t length = fill_inflight();
+        if (length == 0)
+        {
+            schedule_write();
+            return;
+        }
+        writing_ = true;
+        async_with_memory(
+            write_memory_,
+            [this](asio::error_code ec, std::size_t written) {
+                writing_ = false;
+                if (!ec && !stopped_)
+                {
+                    nb_stats_write(slot_, written);
+                    do_write();
+                }
+                else
+                {
+                    handle_error(ec);
+                }
+            },
+            [this, length](auto handler) { asio::async_write(socket_, asio::buffer(write_data_, length), std::move(handler)); });
+    }
+
+    // open-loop: wake up writer, when next message is due (if there is space for it, otherwise ack restarts writer)
+    void schedule_write()
+    {
+        if (interval_ns_ == 0 || timer_armed_ || nb_inflight_space(&inflight_) == 0)
+        {
+            return;
+        }
+        timer_armed_ = true;
+        timer_.expires_at(next_send_time());
+        async_with_memory(
+            timer_memory_,
+            [this](asio::error_code ec) {
+                timer_armed_ = false;
+                if (!ec && !stopped_)
+                {
+                    do_write();
+                }
+            },
+            [this](auto handler) { timer_.async_wait(std::move(handler)); });
     }
+#endif /* ASIO_PP_CORO */
+
     asio::io_service & io_service_;
     asio::ip::tcp::socket socket_;
-    size_t block_size_;
-    char * data_;
-    // size_t read_data_length_;
-    // char * write_data_;
-    // int unwritten_count_;
-    size_t errors;
-    size_t writes_;
-    size_t reads_;
-    size_t bytes_written_;
-    size_t bytes_read_;
-    stats & stats_;
-    // handler_allocator read_allocator_;
-    // handler_allocator write_allocator_;
+    size_t header_size_; // frame header
+    size_t max_message_size_;
+    const nb_sizes * sizes_;
+    uint64_t sizes_state_;
+    char * write_data_; // depth messages
+    char * read_data_;
+    bool stopped_; // completions after stop are not counted
+    bool writing_; // write is in progress
+    uint64_t interval_ns_; // open-loop send interval, 0 for closed-loop
+    uint64_t next_send_ns_; // scheduled time of next open-loop message
+    asio::steady_timer timer_;
+#if !defined(ASIO_PP_CORO)
+    bool timer_armed_;
+#endif
+    bool verify_;
+    nb_verify verify_state_;
+    nb_inflight inflight_; // send time of messages in flight, for round-trip latency (write start to read of last byte)
+    nb_stats_slot * slot_; // counters of the thread, session runs on
+    handler_memory read_memory_;
+    handler_memory write_memory_;
+    handler_memory timer_memory_;
 };
 
 class client
@@ -219,20 +642,18 @@ public:
     client(
         asio::io_service & io_service,
         const asio::ip::tcp::resolver::iterator endpoint_iterator,
-        size_t block_size,
+        const client_options & options,
+        size_t first_session,
         size_t client_session_count,
-        int timeout)
-        : io_service_(io_service), stop_timer_(io_service), client_sessions_(), stats_(block_size, timeout)
+        nb_stats_slot * slot)
+        : io_service_(io_service), client_sessions_()
     {
         for (size_t i = 0; i < client_session_count; ++i)
         {
-            client_session * new_client_session = new client_session(io_service_, block_size, stats_);
+            client_session * new_client_session = new client_session(io_service_, options, first_session + i, slot);
             new_client_session->start(endpoint_iterator);
             client_sessions_.push_back(new_client_session);
         }
-
-        stop_timer_.expires_from_now(boost::posix_time::seconds(timeout));
-        stop_timer_.async_wait(boost::bind(&client::handle_timeout, this));
     }
 
     ~client()
@@ -244,17 +665,87 @@ public:
             delete session;
             client_sessions_.pop_front();
         }
-
-        stats_.print();
     }
 
-    void handle_timeout() { std::for_each(client_sessions_.begin(), client_sessions_.end(), boost::mem_fn(&client_session::stop)); }
+    // stop all sessions, must be called from io_context thread
+    void stop() { std::for_each(client_sessions_.begin(), client_sessions_.end(), boost::mem_fn(&client_session::stop)); }
 
 private:
     asio::io_service & io_service_;
-    asio::deadline_timer stop_timer_;
     std::list<client_session *> client_sessions_;
-    stats stats_;
+};
+
+// Client sessions, sharded across per-thread io_contexts.
+// Shard sessions are created in it's thread after placement, so buffers are local to the thread NUMA node.
+class client_shards
+{
+public:
+    client_shards(const asio::ip::tcp::resolver::iterator endpoint_iterator, const client_options & options, stats & s)
+        : endpoint_iterator_(endpoint_iterator)
+        , options_(options)
+        , started_(static_cast<unsigned>(options.thread_count + 1))
+        , unplaced_(false)
+    {
+        for (size_t i = 0; i < options.thread_count; ++i)
+        {
+            io_contexts_.emplace_back(new asio::io_context());
+            clients_.emplace_back();
+            slots_.push_back(s.slot(i));
+        }
+    }
+
+    // run all shards in background threads, return when sessions are created, false if a thread could not be placed
+    bool start()
+    {
+        for (size_t i = 0; i < io_contexts_.size(); ++i)
+        {
+            threads_.create_thread(boost::bind(&client_shards::run_shard, this, i));
+        }
+        started_.wait();
+        return !unplaced_;
+    }
+
+    // stop sessions in it's threads, io_context run returns, when sessions completions are drained
+    void stop()
+    {
+        for (size_t i = 0; i < io_contexts_.size(); ++i)
+        {
+            client * c = clients_[i].get();
+            asio::post(*io_contexts_[i], [c]() { c->stop(); });
+        }
+        threads_.join_all();
+
+        clients_.clear();
+    }
+
+private:
+    void run_shard(size_t i)
+    {
+        if (nb_thread_place(nb_cpus_get(options_.cpus, i)) == -1)
+        {
+            unplaced_ = true;
+        }
+        nb_perf_attach(options_.perf);
+        nb_cputime_attach(options_.cputime);
+
+        // distribute remainder sessions over first shards
+        size_t per_shard = options_.session_count / options_.thread_count;
+        size_t remainder = options_.session_count % options_.thread_count;
+        size_t shard_sessions = per_shard + (i < remainder ? 1 : 0);
+        size_t first_session = i * per_shard + std::min(i, remainder);
+        clients_[i].reset(new client(*io_contexts_[i], endpoint_iterator_, options_, first_session, shard_sessions, slots_[i]));
+        started_.wait();
+        io_contexts_[i]->run();
+    }
+
+    asio::ip::tcp::resolver::iterator endpoint_iterator_;
+    client_options options_;
+    boost::barrier started_;
+    std::atomic<bool> unplaced_; // unpinned thread would be recorded as placed
+    boost::thread_group threads_;
+    std::vector<std::unique_ptr<asio::io_context>> io_contexts_;
+    std::vector<std::unique_ptr<client>> clients_;
+    std::vector<nb_stats_slot *> slots_;
 };
 
 int main(int argc, char * argv[])
@@ -266,15 +757,51 @@ int main(int argc, char * argv[])
         std::string port_str = "9876";
         int port;
         int block_size = 16384;
+        std::string sizes_spec;
+        nb_sizes sizes;
+        int depth = 1;
+        double rate = 0;
+        bool framed = false;
+        bool verify = false;
         int client_session_count = 0;
         int seconds = 60;
+        int warmup = 0;
+        double interval = 0;
+        int client_threads = 1;
+        int server_threads = 1;
+        handler_alloc handler_mode = handler_alloc::asio;
+        bool session_pool = false;
+        std::string server_cpus_spec;
+        std::string client_cpus_spec;
+        nb_cpus server_cpus = {nullptr, 0};
+        nb_cpus client_cpus = {nullptr, 0};
+        bool perf = false;
+        nb_perf client_perf;
+        nb_perf server_perf;
+        nb_cputime client_cputime;
+        nb_cputime server_cputime;
+        nb_format format = NB_FORMAT_TABLE;
         int client_start = 0;
         int server_start = 1;
+        int ready_fd = -1;
+
+        static struct option long_options[] = {
+            {"handler-alloc", required_argument, 0, 'A'},
+            {"session-alloc", required_argument, 0, 'S'},
+            {"warmup", required_argument, 0, 'W'},
+            {"interval", required_argument, 0, 'I'},
+            {"verify", no_argument, 0, 'V'},
+            {"format", required_argument, 0, 'F'},
+            {"server-cpus", required_argument, 0, 'E'},
+            {"client-cpus", required_argument, 0, 'C'},
+            {"perf", no_argument, 0, 'P'},
+            {"ready-fd", required_argument, 0, 'R'},
+            {0, 0, 0, 0}};
 
 #ifndef WIN32
         struct rlimit rl;
 #endif
-        while ((c = getopt(argc, argv, ":a:b:n:d:h")) != -1)
+        while ((c = getopt_long(argc, argv, ":a:p:b:s:q:r:fn:d:t:T:h", long_options, NULL)) != -1)
         {
             switch (c)
             {
@@ -288,16 +815,117 @@ int main(int argc, char * argv[])
                 case 'b':
                     block_size = atoi(optarg);
                     break;
+                case 's':
+                    sizes_spec = optarg;
+                    break;
+                case 'q':
+                    depth = atoi(optarg);
+                    break;
+                case 'r':
+                    rate = atof(optarg);
+                    break;
+                case 'f':
+                    framed = true;
+                    break;
                 case 'n':
                     client_session_count = atoi(optarg);
                     break;
                 case 'd':
                     seconds = atoi(optarg);
                     break;
+                case 't':
+                    client_threads = atoi(optarg);
+                    break;
+                case 'T':
+                    server_threads = atoi(optarg);
+                    break;
+                case 'W':
+                    warmup = atoi(optarg);
+                    break;
+                case 'I':
+                    interval = atof(optarg);
+                    break;
+                case 'V':
+                    verify = true;
+                    break;
+                case 'E':
+                    server_cpus_spec = optarg;
+                    break;
+                case 'C':
+                    client_cpus_spec = optarg;
+                    break;
+                case 'P':
+                    perf = true;
+                    break;
+                case 'R':
+                    ready_fd = atoi(optarg);
+                    break;
+                case 'F':
+                    if (nb_format_parse(optarg, &format) == -1)
+                    {
+                        exit(1);
+                    }
+                    break;
+                case 'A':
+#if defined(ASIO_PP_CORO)
+                    fprintf(stderr, "Handler allocator is not supported with coroutines, frames and handlers are allocated by asio\n");
+                    exit(1);
+#endif
+                    if (strcmp(optarg, "asio") == 0)
+                    {
+                        handler_mode = handler_alloc::asio;
+                    }
+                    else if (strcmp(optarg, "heap") == 0)
+                    {
+                        handler_mode = handler_alloc::heap;
+                    }
+                    else if (strcmp(optarg, "recycling") == 0)
+                    {
+                        handler_mode = handler_alloc::recycling;
+                    }
+                    else
+                    {
+                        fprintf(stderr, "Invalid handler allocator \"%s\"\n", optarg);
+                        exit(1);
+                    }
+                    break;
+                case 'S':
+                    if (strcmp(optarg, "heap") == 0)
+                    {
+                        session_pool = false;
+                    }
+                    else if (strcmp(optarg, "pool") == 0)
+                    {
+                        session_pool = true;
+                    }
+                    else
+                    {
+                        fprintf(stderr, "Invalid session allocator \"%s\"\n", optarg);
+                        exit(1);
+                    }
+                    break;
                 case 'h': {
                     fprintf(stderr, "Usage: %s -p <port> -b <blocksize> ", argv[0]);
                     fprintf(stderr, "-n <client_sessions> -d <time>\n");
                     fprintf(stderr, "  [-a server] (by default, start internal server)\n");
+                    fprintf(stderr, "  [--ready-fd=fd] (server only: write \"ready\" line to inherited fd when listening, stop on SIGINT/SIGTERM)\n");
+                    fprintf(stderr, "  [--warmup=seconds] (run before measurement, excluded from stats, default 0)\n");
+                    fprintf(stderr, "  [--interval=seconds] (print throughput and latency per interval, default disabled)\n");
+                    fprintf(stderr, "  [--verify] (sequence and CRC32C in each message, check echo, min payload size is 12)\n");
+                    fprintf(stderr, "  [--format=table|csv|json] (result output, json is one object per line, default table)\n");
+                    fprintf(stderr, "  [--server-cpus=list] [--client-cpus=list] (pin event loop threads round-robin, like 0-3,8,\n");
+                    fprintf(stderr, "     memory is preferred from CPU NUMA node, default not pinned)\n");
+                    fprintf(stderr, "  [--perf] (cycles, instructions, cache and branch misses, context switches per message of client and server threads)\n");
+                    fprintf(stderr, "  [-s sizes] (payload size distribution instead of fixed blocksize, blocksize is set to max size:\n");
+                    fprintf(stderr, "     fixed:SIZE uniform:MIN:MAX lognormal:MEDIAN:SIGMA:MAX bimodal:SMALL:LARGE:PERCENT file:PATH)\n");
+                    fprintf(stderr, "  [-q depth] (messages in flight per session, default 1)\n");
+                    fprintf(stderr, "  [-r rate] (open-loop messages/s for all sessions, latency from scheduled send time, default closed-loop)\n");
+                    fprintf(stderr, "  [-f] (length-prefixed frames with blocksize payload, server echoes whole frames)\n");
+                    fprintf(stderr, "  [-t client_threads] (sessions sharded across io_context per thread, default 1)\n");
+                    fprintf(stderr, "  [-T server_threads] (io_context per thread, listeners with SO_REUSEPORT, default 1)\n");
+                    fprintf(stderr, "  [--handler-alloc=asio|heap|recycling] (handler memory: asio default allocator with its thread-local cache,\n");
+                    fprintf(stderr, "     global heap per operation or recycled block per operation type, default asio, not in asio_pp_coro)\n");
+                    fprintf(stderr, "  [--session-alloc=heap|pool] (server session and buffer memory, default heap)\n");
                     exit(1);
                 }
                 default:
@@ -321,22 +949,90 @@ int main(int argc, char * argv[])
                 fprintf(stderr, "Invalid block_size\n");
                 return 1;
             }
+            if (depth <= 0)
+            {
+                fprintf(stderr, "Invalid depth\n");
+                return 1;
+            }
+            // send interval is whole nanoseconds, 0 would be closed-loop
+            if (rate < 0 || (rate > 0 && 1e9 * client_session_count / rate < 1))
+            {
+                fprintf(stderr, "Invalid rate\n");
+                return 1;
+            }
+            if (warmup < 0 || interval < 0)
+            {
+                fprintf(stderr, "Invalid warmup or interval\n");
+                return 1;
+            }
             if (seconds <= 0)
             {
                 fprintf(stderr, "Invalid durations\n");
                 return 1;
             }
+            if (client_threads <= 0 || client_threads > client_session_count)
+            {
+                fprintf(stderr, "Invalid client threads\n");
+                return 1;
+            }
         }
         else if (server_start == 0)
         {
             fprintf(stderr, "Invalid options, nothing started\n");
             return 1;
         }
+        if (ready_fd != -1 && (client_start || ready_fd < 0))
+        {
+            fprintf(stderr, "Invalid ready fd, it is for server only mode\n");
+            return 1;
+        }
+        if (server_threads <= 0)
+        {
+            fprintf(stderr, "Invalid server threads\n");
+            return 1;
+        }
+        if (sizes_spec.empty())
+        {
+            sizes_spec = "fixed:" + std::to_string(block_size);
+        }
+        if (nb_sizes_parse(&sizes, sizes_spec.c_str()) == -1)
+        {
+            return 1;
+        }
+        block_size = static_cast<int>(sizes.max);
+        if (verify && block_size < NB_VERIFY_TRAILER)
+        {
+            fprintf(stderr, "Block size must be at least %d for verify\n", NB_VERIFY_TRAILER);
+            return 1;
+        }
+
+        if (!server_cpus_spec.empty() && nb_cpus_parse(&server_cpus, server_cpus_spec.c_str()) == -1)
+        {
+            return 1;
+        }
+        if (!client_cpus_spec.empty() && nb_cpus_parse(&client_cpus, client_cpus_spec.c_str()) == -1)
+        {
+            return 1;
+        }
+
+        if (nb_perf_init(&client_perf, perf) == -1 || nb_perf_init(&server_perf, perf) == -1 || nb_cputime_init(&client_cputime) == -1
+            || nb_cputime_init(&server_cputime) == -1)
+        {
+            return 1;
+        }
 
         signal(SIGPIPE, SIG_IGN);
 
 #ifndef WIN32
-        rl.rlim_cur = rl.rlim_max = client_session_count * 2 + 50;
+        // server process does not know client sessions count, takes all it is allowed
+        if (client_start)
+        {
+            rl.rlim_cur = rl.rlim_max = client_session_count * 2 + 50;
+        }
+        else if (getrlimit(RLIMIT_NOFILE, &rl) == 0)
+        {
+            rl.rlim_cur = rl.rlim_max;
+        }
         if (setrlimit(RLIMIT_NOFILE, &rl) == -1)
         {
             perror("setrlimit");
@@ -344,19 +1040,42 @@ int main(int argc, char * argv[])
         }
 #endif
 
-        service_runner * server = nullptr;
-        boost::thread * thread_server = nullptr;
+        server_options s_options;
+        s_options.block_size = static_cast<size_t>(block_size);
+        s_options.framed = framed;
+        s_options.handler_mode = handler_mode;
+        s_options.session_pool = session_pool;
+
+        server_group * server = nullptr;
         if (server_start)
         {
-            server = new service_runner();
+            server = new server_group(static_cast<size_t>(server_threads), &server_cpus, server_cpus_spec, &server_perf, &server_cputime);
             if (client_start)
             {
-                thread_server = new boost::thread(server_run, server, static_cast<unsigned short>(port), static_cast<size_t>(block_size));
-                sleep(1);
+                int ready_fds[2];
+                if (pipe(ready_fds) == -1)
+                {
+                    perror("pipe");
+                    return 1;
+                }
+                server->start(static_cast<unsigned short>(port), s_options, ready_fds[1]);
+                if (nb_ready_wait(ready_fds[0], 10000) == -1)
+                {
+                    delete server;
+                    return 1;
+                }
             }
             else
             {
-                server_run(server, static_cast<unsigned short>(port), static_cast<size_t>(block_size));
+                server->run(static_cast<unsigned short>(port), s_options, ready_fd);
+
+                // accept rate and allocations of server process, on stdout of server
+                nb_result result;
+                nb_result_init(&result);
+                nb_result_str(&result, "engine", "Engine", engine_name());
+                nb_result_int(&result, "servers", "Servers", (int64_t)server->size());
+                server->result(&result);
+                nb_result_print(stdout, format, &result, 1);
 
                 delete server;
                 exit(0);
@@ -370,18 +1089,65 @@ int main(int argc, char * argv[])
             asio::ip::tcp::resolver r(ios);
             asio::ip::tcp::resolver::iterator iter = r.resolve(asio::ip::tcp::resolver::query(host, port_str));
 
-            client cl(ios, iter, block_size, client_session_count, seconds);
+            client_options c_options;
+            c_options.block_size = static_cast<size_t>(block_size);
+            c_options.sizes = &sizes;
+            c_options.sizes_spec = sizes_spec;
+            c_options.depth = static_cast<size_t>(depth);
+            c_options.rate = rate;
+            c_options.framed = framed;
+            c_options.verify = verify;
+            c_options.session_count = static_cast<size_t>(client_session_count);
+            c_options.thread_count = static_cast<size_t>(client_threads);
+            c_options.timeout = seconds;
+            c_options.warmup = warmup;
+            c_options.interval = interval;
+            c_options.handler_mode = handler_mode;
+            c_options.cpus = &client_cpus;
+            c_options.cpus_spec = client_cpus_spec;
+            c_options.perf = &client_perf;
+            c_options.cputime = &client_cputime;
+            c_options.format = format;
+
+            stats st(c_options, server, server ? &server_perf : nullptr, server ? &server_cputime : nullptr);
+            client_shards cl(iter, c_options, st);
 
-            ios.run();
+            if (!cl.start())
+            {
+                cl.stop();
+                delete server;
+                return 1;
+            }
+            st.measure();
+            cl.stop();
+
+            // internal server stats are in the same record
+            nb_result result;
+            nb_result_init(&result);
+            st.result(&result);
+            if (server)
+            {
+                server->stop();
+                server->join();
+                server->result(&result);
+            }
+            nb_result_print(stdout, format, &result, 1);
         }
 
         if (server)
         {
             server->stop();
-            thread_server->join();
+            server->join();
             delete server;
-            delete thread_server;
         }
+
+        nb_sizes_free(&sizes);
+        nb_cpus_free(&server_cpus);
+        nb_cpus_free(&client_cpus);
+        nb_perf_free(&client_perf);
+        nb_perf_free(&server_perf);
+        nb_cputime_free(&client_cputime);
+        nb_cputime_free(&server_cputime);
     }
     catch (std::exception & e)
     {
@@ -1,8 +1,8 @@
 //
-// handler_allocator.cpp
+// handler_allocator.hpp
 // ~~~~~~~~~~~~~~~~~~~~~
 //
-// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2003-2020 Christopher M. Kohlhoff (chris at kohlhoff dot com)
 //
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
@@ -11,39 +11,79 @@
 #ifndef HANDLER_ALLOCATOR_HPP
 #define HANDLER_ALLOCATOR_HPP
 
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
 #include "asio.hpp"
-#include <boost/aligned_storage.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <netbench/stats.h>
+
+// Handler memory mode: asio - handlers are not wrapped, asio default allocator
+// (thread-local recycling cache, not counted), heap - global heap per
+// operation, recycling - single block of handler_memory.
+enum class handler_alloc
+{
+  asio,
+  heap,
+  recycling
+};
+
+inline const char* handler_alloc_name(handler_alloc mode)
+{
+  switch (mode)
+  {
+  case handler_alloc::heap:
+    return "heap";
+  case handler_alloc::recycling:
+    return "recycling";
+  default:
+    return "asio";
+  }
+}
+
 // Class to manage the memory to be used for handler-based custom allocation.
 // It contains a single block of memory which may be returned for allocation
-// requests. If the memory is in use when an allocation request is made, the
-// allocator delegates allocation to the global heap.
-class handler_allocator
+// requests. If the memory is in use when an allocation request is made, or
+// recycling is disabled, the allocator delegates allocation to the global heap.
+class handler_memory
   : private boost::noncopyable
 {
 public:
-  handler_allocator()
-    : in_use_(false)
+  explicit handler_memory(handler_alloc mode = handler_alloc::recycling,
+      uint64_t* heap_counter = nullptr)
+    : in_use_(false),
+      mode_(mode),
+      heap_counter_(heap_counter)
   {
   }
 
+  handler_alloc mode() const
+  {
+    return mode_;
+  }
+
   void* allocate(std::size_t size)
   {
-    if (!in_use_ && size < storage_.size)
+    if (mode_ == handler_alloc::recycling && !in_use_ && size < sizeof(storage_))
     {
       in_use_ = true;
-      return storage_.address();
+      return &storage_;
     }
     else
     {
+      if (heap_counter_)
+      {
+        nb_counter_add(heap_counter_, 1);
+      }
       return ::operator new(size);
     }
   }
 
   void deallocate(void* pointer)
   {
-    if (pointer == storage_.address())
+    if (pointer == &storage_)
     {
       in_use_ = false;
     }
@@ -55,60 +95,118 @@ public:
 
 private:
   // Storage space used for handler-based custom memory allocation.
-  boost::aligned_storage<1024> storage_;
+  typename std::aligned_storage<1024>::type storage_;
 
   // Whether the handler-based custom allocation storage has been used.
   bool in_use_;
+
+  // Storage is used only in recycling mode.
+  handler_alloc mode_;
+
+  // Heap allocations counter (single writer), can be null.
+  uint64_t* heap_counter_;
 };
 
-// Wrapper class template for handler objects to allow handler memory
-// allocation to be customised. Calls to operator() are forwarded to the
-// encapsulated handler.
-template <typename Handler>
-class custom_alloc_handler
+// The allocator to be associated with the handler objects. This allocator only
+// needs to satisfy the C++11 minimal allocator requirements.
+template <typename T>
+class handler_allocator
 {
 public:
-  custom_alloc_handler(handler_allocator& a, Handler h)
-    : allocator_(a),
-      handler_(h)
+  using value_type = T;
+
+  explicit handler_allocator(handler_memory& mem)
+    : memory_(mem)
+  {
+  }
+
+  template <typename U>
+  handler_allocator(const handler_allocator<U>& other) noexcept
+    : memory_(other.memory_)
+  {
+  }
+
+  bool operator==(const handler_allocator& other) const noexcept
   {
+    return &memory_ == &other.memory_;
   }
 
-  template <typename Arg1>
-  void operator()(Arg1 arg1)
+  bool operator!=(const handler_allocator& other) const noexcept
   {
-    handler_(arg1);
+    return &memory_ != &other.memory_;
   }
 
-  template <typename Arg1, typename Arg2>
-  void operator()(Arg1 arg1, Arg2 arg2)
+  T* allocate(std::size_t n) const
   {
-    handler_(arg1, arg2);
+    return static_cast<T*>(memory_.allocate(sizeof(T) * n));
   }
 
-  friend void* asio_handler_allocate(std::size_t size,
-      custom_alloc_handler<Handler>* this_handler)
+  void deallocate(T* p, std::size_t /*n*/) const
   {
-    return this_handler->allocator_.allocate(size);
+    return memory_.deallocate(p);
   }
 
-  friend void asio_handler_deallocate(void* pointer, std::size_t /*size*/,
-      custom_alloc_handler<Handler>* this_handler)
+private:
+  template <typename> friend class handler_allocator;
+
+  // The underlying memory.
+  handler_memory& memory_;
+};
+
+// Wrapper class template for handler objects to allow handler memory
+// allocation to be customised. The allocator_type type and get_allocator()
+// member function are used by the asynchronous operations to obtain the
+// allocator. Calls to operator() are forwarded to the encapsulated handler.
+template <typename Handler>
+class custom_alloc_handler
+{
+public:
+  using allocator_type = handler_allocator<Handler>;
+
+  custom_alloc_handler(handler_memory& m, Handler h)
+    : memory_(m),
+      handler_(std::move(h))
   {
-    this_handler->allocator_.deallocate(pointer);
+  }
+
+  allocator_type get_allocator() const noexcept
+  {
+    return allocator_type(memory_);
+  }
+
+  template <typename ...Args>
+  void operator()(Args&&... args)
+  {
+    handler_(std::forward<Args>(args)...);
   }
 
 private:
-  handler_allocator& allocator_;
+  handler_memory& memory_;
   Handler handler_;
 };
 
 // Helper function to wrap a handler object to add custom allocation.
 template <typename Handler>
 inline custom_alloc_handler<Handler> make_custom_alloc_handler(
-    handler_allocator& a, Handler h)
+    handler_memory& m, Handler h)
+{
+  return custom_alloc_handler<Handler>(m, std::move(h));
+}
+
+// Helper function to start an asynchronous operation: initiate is called with
+// the handler wrapped to allocate from memory, or with the handler as is in
+// asio mode, so the operation uses asio default allocator.
+template <typename Handler, typename Initiate>
+inline void async_with_memory(handler_memory& m, Handler h, Initiate initiate)
 {
-  return custom_alloc_handler<Handler>(a, h);
+  if (m.mode() == handler_alloc::asio)
+  {
+    initiate(std::move(h));
+  }
+  else
+  {
+    initiate(make_custom_alloc_handler(m, std::move(h)));
+  }
 }
 
 #endif // HANDLER_ALLOCATOR_HPP
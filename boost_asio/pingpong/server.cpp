@@ -11,29 +11,103 @@
 #include "pch.h" // precompiled header, add other headers after
 
 #include <algorithm>
+#include <cstring>
+#include <stdexcept>
 #include <iostream>
 #include <list>
 #include "asio.hpp"
 #include "handler_allocator.hpp"
 #include <boost/bind.hpp>
+#include <boost/intrusive_ptr.hpp>
+
+#include <netbench/frame.h>
+#include <netbench/ready.h>
 
 #include "server.hpp"
+#include "session_pool.hpp"
 
-class server_session : public std::enable_shared_from_this<server_session>
+// Framed sessions need space for header of one whole frame
+static size_t session_buffer_size(const server_options & options)
 {
-public:
-    server_session(asio::ip::tcp::socket socket, size_t block_size)
-        : socket_(std::move(socket)), block_size_(block_size), data_(new char[block_size])
+    return options.framed ? NB_FRAME_HEADER_SIZE + options.block_size : options.block_size;
+}
+
+// Size of data to echo: whole frames in framed mode (0 if none yet, (size_t)-1 on oversized frame), everything otherwise
+static size_t echo_size(const server_options & options, const char * data, size_t size)
+{
+    return options.framed ? nb_frame_complete(data, size, options.block_size) : size;
+}
+
+#if defined(ASIO_PP_CORO)
+
+// Session state lives in coroutine frame, buffer is taken from thread session_pool
+static asio::awaitable<void> server_session(asio::ip::tcp::socket socket, server_options options, session_pool & pool)
+{
+    struct pool_buffer
+    {
+        // returned to pool even if frame is destroyed by io_context without resume
+        pool_buffer(session_pool & p) : pool(p) { mem = pool.allocate(data); }
+        ~pool_buffer() { pool.deallocate(mem, data); }
+
+        session_pool & pool;
+        void * mem;
+        char * data;
+    } buffer(pool);
+
+    asio::error_code set_option_err;
+    asio::ip::tcp::no_delay no_delay(true);
+    socket.set_option(no_delay, set_option_err);
+    if (set_option_err)
+    {
+        co_return;
+    }
+
+    try
+    {
+        size_t capacity = session_buffer_size(options);
+        size_t filled = 0;
+        for (;;)
+        {
+            filled += co_await socket.async_read_some(asio::buffer(buffer.data + filled, capacity - filled), asio::use_awaitable);
+            size_t length = echo_size(options, buffer.data, filled);
+            if (length == (size_t)-1)
+            {
+                break;
+            }
+            if (length > 0)
+            {
+                co_await asio::async_write(socket, asio::buffer(buffer.data, length), asio::use_awaitable);
+                // keep incomplete frame
+                filled -= length;
+                memmove(buffer.data, buffer.data + length, filled);
+            }
+        }
+    }
+    catch (std::exception &)
     {
     }
+}
 
-    ~server_session() { delete[] data_; }
+#else
+
+// Session is owned by pending handlers with intrusive (not thread-safe) reference counter,
+// sessions never cross threads. Object and buffer memory is returned to thread session_pool on close.
+class server_session
+{
+public:
+    static server_session * create(asio::ip::tcp::socket socket, const server_options & options, session_pool & pool)
+    {
+        char * buffer;
+        void * mem = pool.allocate(buffer);
+        return new (mem) server_session(std::move(socket), options, buffer, pool);
+    }
 
     asio::ip::tcp::socket & socket() { return socket_; }
 
     void start()
     {
-        auto self(shared_from_this());
+        // session is destroyed on return, if no operation is started
+        boost::intrusive_ptr<server_session> self(this);
         asio::error_code set_option_err;
         asio::ip::tcp::no_delay no_delay(true);
         socket_.set_option(no_delay, set_option_err);
@@ -44,85 +118,155 @@ public:
         }
     }
 
+    friend void intrusive_ptr_add_ref(server_session * s) { ++s->refs_; }
+
+    friend void intrusive_ptr_release(server_session * s)
+    {
+        if (--s->refs_ == 0)
+        {
+            s->destroy();
+        }
+    }
+
 private:
+    server_session(asio::ip::tcp::socket socket, const server_options & options, char * buffer, session_pool & pool)
+        : socket_(std::move(socket))
+        , options_(options)
+        , capacity_(session_buffer_size(options))
+        , filled_(0)
+        , data_(buffer)
+        , read_memory_(options.handler_mode, pool.handler_allocations())
+        , write_memory_(options.handler_mode, pool.handler_allocations())
+        , pool_(pool)
+        , refs_(0)
+    {
+    }
+
+    void destroy()
+    {
+        session_pool & pool = pool_;
+        char * buffer = data_;
+        this->~server_session();
+        pool.deallocate(this, buffer);
+    }
+
     void do_read()
     {
-        auto self(shared_from_this());
-        socket_.async_read_some(
-            asio::buffer(data_, block_size_),
-            [this, self](std::error_code ec, std::size_t length) {
+        boost::intrusive_ptr<server_session> self(this);
+        async_with_memory(
+            read_memory_,
+            [this, self](asio::error_code ec, std::size_t length) {
                 if (!ec)
                 {
-                    do_write(length);
+                    filled_ += length;
+                    length = echo_size(options_, data_, filled_);
+                    if (length == 0)
+                    {
+                        do_read();
+                    }
+                    else if (length != (size_t)-1)
+                    {
+                        do_write(length);
+                    }
                 }
-            });
-            // make_custom_alloc_handler(read_allocator_, [this, self](std::error_code ec, std::size_t length) {
-            //     if (!ec)
-            //     {
-            //         do_write(length);
-            //     }
-            // }));
+            },
+            [this](auto handler) { socket_.async_read_some(asio::buffer(data_ + filled_, capacity_ - filled_), std::move(handler)); });
     }
 
     void do_write(std::size_t length)
     {
-        auto self(shared_from_this());
-        asio::async_write(
-            socket_,
-            asio::buffer(data_, length),
-            [this, self](std::error_code ec, std::size_t /*length*/) {
+        boost::intrusive_ptr<server_session> self(this);
+        async_with_memory(
+            write_memory_,
+            [this, self](asio::error_code ec, std::size_t written) {
                 if (!ec)
                 {
+                    // keep incomplete frame
+                    filled_ -= written;
+                    memmove(data_, data_ + written, filled_);
                     do_read();
                 }
-            });
-            //make_custom_alloc_handler(write_allocator_, [this, self](std::error_code ec, std::size_t /*length*/) {
-            // [this, self](std::error_code ec, std::size_t /*length*/) {
-            //     if (!ec)
-            //     {
-            //         do_read();
-            //     }
-            // }));
+            },
+            [this, length](auto handler) { asio::async_write(socket_, asio::buffer(data_, length), std::move(handler)); });
     }
 
     asio::ip::tcp::socket socket_;
-    size_t block_size_;
+    server_options options_;
+    size_t capacity_;
+    size_t filled_; // received, but not echoed yet
     char * data_;
-    // handler_allocator read_allocator_;
-    // handler_allocator write_allocator_;
+    handler_memory read_memory_;
+    handler_memory write_memory_;
+    session_pool & pool_;
+    size_t refs_;
 };
 
+#endif /* ASIO_PP_CORO */
+
 class server
 {
 public:
-    server(asio::io_service & ios, const asio::ip::tcp::endpoint & endpoint, size_t block_size)
-        : io_context_(ios), acceptor_(ios), block_size_(block_size)
+    server(
+        asio::io_service & ios,
+        const asio::ip::tcp::endpoint & endpoint,
+        const server_options & options,
+        session_pool & pool,
+        bool reuse_port)
+        : io_context_(ios), acceptor_(ios), options_(options), pool_(pool)
     {
         acceptor_.open(endpoint.protocol());
         acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(1));
+        if (reuse_port)
+        {
+            acceptor_.set_option(asio::reuse_port(1));
+        }
         acceptor_.bind(endpoint);
         acceptor_.listen();
 
+#if defined(ASIO_PP_CORO)
+        asio::co_spawn(io_context_, do_accept(), asio::detached);
+#else
         do_accept();
+#endif
     }
 
 
 private:
+#if defined(ASIO_PP_CORO)
+    asio::awaitable<void> do_accept()
+    {
+        for (;;)
+        {
+            asio::error_code ec;
+            asio::ip::tcp::socket socket = co_await acceptor_.async_accept(asio::redirect_error(asio::use_awaitable, ec));
+            if (ec == asio::error::operation_aborted)
+            {
+                co_return;
+            }
+            if (!ec)
+            {
+                asio::co_spawn(io_context_, server_session(std::move(socket), options_, pool_), asio::detached);
+            }
+        }
+    }
+#else
     void do_accept()
     {
         acceptor_.async_accept([this](std::error_code ec, asio::ip::tcp::socket socket) {
             if (!ec)
             {
-                std::make_shared<server_session>(std::move(socket), block_size_)->start();
+                server_session::create(std::move(socket), options_, pool_)->start();
             }
 
             do_accept();
         });
     }
+#endif
 
     asio::io_service & io_context_;
     asio::ip::tcp::acceptor acceptor_;
-    size_t block_size_;
+    server_options options_;
+    session_pool & pool_;
 };
 
 // private:
@@ -132,8 +276,198 @@ private:
 //     boost::thread_group thread_group_;
 // };
 
-void server_run(service_runner * runner, unsigned short port, size_t block_size)
+void server_run(
+    service_runner * runner,
+    session_pool * pool,
+    unsigned short port,
+    const server_options & options,
+    bool reuse_port,
+    const std::function<void(bool)> & listening)
 {
-    server s(runner->io_context(), asio::ip::tcp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), block_size);
+    std::unique_ptr<server> s;
+    try
+    {
+        s.reset(new server(
+            runner->io_context(), asio::ip::tcp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), options, *pool, reuse_port));
+    }
+    catch (...)
+    {
+        listening(false);
+        throw;
+    }
+    listening(true);
     runner->run();
 }
+
+static void server_thread(
+    service_runner * runner,
+    session_pool * pool,
+    unsigned short port,
+    const server_options & options,
+    bool reuse_port,
+    int cpu,
+    nb_perf * perf,
+    nb_cputime * cputime,
+    const std::function<void(bool)> & listening)
+{
+    // before pool slabs and session buffers are allocated, unpinned thread would be recorded as placed
+    if (nb_thread_place(cpu) == -1)
+    {
+        listening(false);
+        return;
+    }
+    nb_perf_attach(perf);
+    nb_cputime_attach(cputime);
+    try
+    {
+        server_run(runner, pool, port, options, reuse_port, listening);
+    }
+    catch (std::exception & e)
+    {
+        std::cerr << "Server exception: " << e.what() << "\n";
+    }
+}
+
+server_group::server_group(
+    size_t thread_count, const nb_cpus * cpus, const std::string & cpus_spec, nb_perf * perf, nb_cputime * cputime)
+    : cpus_(cpus), cpus_spec_(cpus_spec), perf_(perf), cputime_(cputime), ready_fd_(-1), listening_(0), failed_(false)
+{
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        runners_.emplace_back(new service_runner());
+    }
+}
+
+server_group::~server_group()
+{
+    stop();
+    join();
+}
+
+void server_group::start_threads(size_t first, unsigned short port, const server_options & options, int ready_fd)
+{
+    bool reuse_port = runners_.size() > 1;
+    options_ = options;
+    ready_fd_ = ready_fd;
+    if (pools_.empty())
+    {
+        for (size_t i = 0; i < runners_.size(); ++i)
+        {
+#if defined(ASIO_PP_CORO)
+            // session object is coroutine frame
+            pools_.emplace_back(new session_pool(0, session_buffer_size(options), options.session_pool));
+#else
+            pools_.emplace_back(new session_pool(sizeof(server_session), session_buffer_size(options), options.session_pool));
+#endif
+        }
+    }
+    for (size_t i = first; i < runners_.size(); ++i)
+    {
+        threads_.create_thread(boost::bind(
+            server_thread,
+            runners_[i].get(),
+            pools_[i].get(),
+            port,
+            options,
+            reuse_port,
+            nb_cpus_get(cpus_, i),
+            perf_,
+            cputime_,
+            [this](bool ok) { listening(ok); }));
+    }
+}
+
+// Last listener (or failed one) notifies, so ready means every thread accepts
+void server_group::listening(bool ok)
+{
+    if (!ok && !failed_.exchange(true))
+    {
+        nb_ready_notify(ready_fd_, 0);
+    }
+    if (ok && ++listening_ == runners_.size())
+    {
+        nb_ready_notify(ready_fd_, 1);
+    }
+}
+
+void server_group::start(unsigned short port, const server_options & options, int ready_fd)
+{
+    start_threads(0, port, options, ready_fd);
+}
+
+void server_group::run(unsigned short port, const server_options & options, int ready_fd)
+{
+    start_threads(1, port, options, ready_fd);
+    if (nb_thread_place(nb_cpus_get(cpus_, 0)) == -1)
+    {
+        listening(false);
+        stop();
+        join();
+        throw std::runtime_error("Couldn't place server thread");
+    }
+    nb_perf_attach(perf_);
+    nb_cputime_attach(cputime_);
+
+    // server process is stopped by launcher (or Ctrl-C), threads are joined and memory is released
+    asio::signal_set signals(runners_[0]->io_context(), SIGINT, SIGTERM);
+    signals.async_wait([this](const asio::error_code & ec, int) {
+        if (!ec)
+        {
+            stop();
+        }
+    });
+    try
+    {
+        server_run(runners_[0].get(), pools_[0].get(), port, options, runners_.size() > 1, [this](bool ok) { listening(ok); });
+    }
+    catch (...)
+    {
+        stop();
+        join();
+        throw;
+    }
+    join();
+}
+
+void server_group::stop()
+{
+    for (auto & runner : runners_)
+    {
+        runner->stop();
+    }
+}
+
+void server_group::join()
+{
+    threads_.join_all();
+}
+
+uint64_t server_group::handler_allocations() const
+{
+    uint64_t allocations = 0;
+    for (auto & pool : pools_)
+    {
+        allocations += nb_counter_load(pool->handler_allocations());
+    }
+    return allocations;
+}
+
+void server_group::result(nb_result * r)
+{
+    session_alloc_stats stats;
+    for (auto & pool : pools_)
+    {
+        stats.merge(pool->stats());
+    }
+
+    double elapsed = (double)(stats.last_ns - stats.first_ns) / 1000000000;
+
+    char nodes[64];
+    nb_cpus_nodes(cpus_, runners_.size(), nodes, sizeof(nodes));
+    nb_result_str(r, "server_cpus", "Server CPUs", cpus_spec_.empty() ? "-" : cpus_spec_.c_str());
+    nb_result_str(r, "server_nodes", "Server nodes", nodes);
+    nb_result_str(r, "server_sessions", "Server sessions", options_.session_pool ? "pool" : "heap");
+    nb_result_int(r, "accepts", "Accepts", (int64_t)stats.sessions);
+    nb_result_double(r, "accept_rate", "Accept rate/s", elapsed > 0 ? (double)(stats.sessions - 1) / elapsed : 0.0, 3);
+    nb_result_double(r, "allocs_per_accept", "Allocs/accept", stats.sessions ? static_cast<double>(stats.allocations) / static_cast<double>(stats.sessions) : 0.0, 3);
+}
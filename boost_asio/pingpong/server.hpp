@@ -1,7 +1,19 @@
 #ifndef _SERVER_HPP
 #define _SERVER_HPP
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "asio.hpp"
+#include "handler_allocator.hpp"
+
+#include <netbench/affinity.h>
+#include <netbench/cputime.h>
+#include <netbench/perf.h>
+#include <netbench/result.h>
 
 struct service_runner
 {
@@ -31,6 +43,71 @@ private:
     asio::executor_work_guard<asio::io_context::executor_type> io_context_work_;
 };
 
-void server_run(service_runner * runner, unsigned short port, size_t block_size);
+struct server_options
+{
+    size_t block_size; // max frame payload size in framed mode
+    bool framed; // echo only whole length-prefixed frames
+    handler_alloc handler_mode; // handler memory: asio default allocator, heap per operation or recycled block
+    bool session_pool; // session object and buffer from per-thread pool, heap allocation per accept if false
+};
+
+class session_pool;
+
+// listening(true) is called when acceptor is bound, listening(false) if bind fails (exception is rethrown)
+void server_run(
+    service_runner * runner,
+    session_pool * pool,
+    unsigned short port,
+    const server_options & options,
+    bool reuse_port,
+    const std::function<void(bool)> & listening);
+
+// Per-core server topology: one io_context per thread, each with own acceptor bound to the same port with SO_REUSEPORT,
+// so kernel spreads incoming connections and sessions never cross threads.
+class server_group
+{
+public:
+    // threads are placed on cpus round-robin (empty list - not pinned) and attach to perf counters and CPU time groups,
+    // cpus, perf and cputime must outlive group
+    server_group(size_t thread_count, const nb_cpus * cpus, const std::string & cpus_spec, nb_perf * perf, nb_cputime * cputime);
+
+    ~server_group();
+
+    size_t size() const { return runners_.size(); }
+
+    // start all servers in background threads, nb_ready_notify(ready_fd) when all are listening (-1 - none)
+    void start(unsigned short port, const server_options & options, int ready_fd);
+
+    // run first server in the calling thread, rest in background threads, until stop() or SIGINT/SIGTERM
+    void run(unsigned short port, const server_options & options, int ready_fd);
+
+    void stop();
+
+    void join();
+
+    // heap allocations of handlers of all threads (not counted in asio mode), from any thread while group is running
+    uint64_t handler_allocations() const;
+
+    // append session allocation stats to result, call after join
+    void result(nb_result * r);
+
+private:
+    void start_threads(size_t first, unsigned short port, const server_options & options, int ready_fd);
+
+    void listening(bool ok);
+
+    server_options options_;
+    const nb_cpus * cpus_;
+    std::string cpus_spec_;
+    nb_perf * perf_;
+    nb_cputime * cputime_;
+    int ready_fd_;
+    std::atomic<size_t> listening_;
+    std::atomic<bool> failed_;
+    // per-thread session pools, must be destroyed after io_context (pending handlers own sessions)
+    std::vector<std::unique_ptr<session_pool>> pools_;
+    std::vector<std::unique_ptr<service_runner>> runners_;
+    boost::thread_group threads_;
+};
 
 #endif /* _SERVER_HPP */
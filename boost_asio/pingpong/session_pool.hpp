@@ -0,0 +1,153 @@
+#ifndef _SESSION_POOL_HPP
+#define _SESSION_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <netbench/clock.h>
+
+// Session allocation counters of server thread
+struct session_alloc_stats
+{
+    uint64_t sessions;
+    uint64_t allocations; // heap allocations for session objects and buffers
+    uint64_t first_ns; // first session allocation time
+    uint64_t last_ns; // last session allocation time
+
+    session_alloc_stats() : sessions(0), allocations(0), first_ns(0), last_ns(0) { }
+
+    void merge(const session_alloc_stats & other)
+    {
+        if (other.sessions == 0)
+        {
+            return;
+        }
+        if (sessions == 0 || other.first_ns < first_ns)
+        {
+            first_ns = other.first_ns;
+        }
+        if (other.last_ns > last_ns)
+        {
+            last_ns = other.last_ns;
+        }
+        sessions += other.sessions;
+        allocations += other.allocations;
+    }
+};
+
+// Per-thread (not thread-safe) allocator for session object with it's block buffer (object_size can be 0).
+// In pooled mode object and buffer are placed in one contiguous slot, slots are carved from slabs
+// and recycled on session close. Otherwise object and buffer are separately allocated from heap.
+class session_pool : private boost::noncopyable
+{
+public:
+    session_pool(size_t object_size, size_t buffer_size, bool pooled, size_t slab_slots = 64)
+        : object_size_(align(object_size))
+        , buffer_size_(buffer_size)
+        , slot_size_(align(object_size_ + buffer_size))
+        , slab_slots_(slab_slots)
+        , pooled_(pooled)
+        , free_(nullptr)
+        , handler_allocations_(0)
+    {
+    }
+
+    ~session_pool()
+    {
+        for (void * slab : slabs_)
+        {
+            ::operator delete(slab);
+        }
+    }
+
+    bool pooled() const { return pooled_; }
+
+    const session_alloc_stats & stats() const { return stats_; }
+
+    // heap allocations of handlers of the thread sessions, single writer (nb_counter_add), read with nb_counter_load
+    uint64_t * handler_allocations() { return &handler_allocations_; }
+
+    // allocate memory for session object, buffer_size bytes buffer returned in buffer
+    void * allocate(char *& buffer)
+    {
+        uint64_t now = nb_time_ns();
+        if (stats_.sessions++ == 0)
+        {
+            stats_.first_ns = now;
+        }
+        stats_.last_ns = now;
+
+        if (!pooled_)
+        {
+            ++stats_.allocations;
+            buffer = new char[buffer_size_];
+            if (object_size_ == 0)
+            {
+                // buffer only
+                return nullptr;
+            }
+            ++stats_.allocations;
+            return ::operator new(object_size_);
+        }
+
+        if (free_ == nullptr)
+        {
+            grow();
+        }
+        free_slot * slot = free_;
+        free_ = slot->next;
+        buffer = reinterpret_cast<char *>(slot) + object_size_;
+        return slot;
+    }
+
+    void deallocate(void * object, char * buffer)
+    {
+        if (!pooled_)
+        {
+            delete[] buffer;
+            ::operator delete(object);
+            return;
+        }
+
+        free_slot * slot = static_cast<free_slot *>(object);
+        slot->next = free_;
+        free_ = slot;
+    }
+
+private:
+    struct free_slot
+    {
+        free_slot * next;
+    };
+
+    static size_t align(size_t size) { return (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1); }
+
+    void grow()
+    {
+        char * slab = static_cast<char *>(::operator new(slot_size_ * slab_slots_));
+        ++stats_.allocations;
+        slabs_.push_back(slab);
+        // push in reverse order, so slots are taken in address order
+        for (size_t i = slab_slots_; i > 0; --i)
+        {
+            free_slot * slot = reinterpret_cast<free_slot *>(slab + (i - 1) * slot_size_);
+            slot->next = free_;
+            free_ = slot;
+        }
+    }
+
+    size_t object_size_;
+    size_t buffer_size_;
+    size_t slot_size_;
+    size_t slab_slots_;
+    bool pooled_;
+    free_slot * free_;
+    std::vector<void *> slabs_;
+    session_alloc_stats stats_;
+    uint64_t handler_allocations_;
+};
+
+#endif /* _SESSION_POOL_HPP */
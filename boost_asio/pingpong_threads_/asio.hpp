@@ -5,4 +5,7 @@ namespace asio
 {
   using namespace boost::asio;
   using boost::system::error_code;
+
+  // SO_REUSEPORT socket option, not provided by asio
+  typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
 }
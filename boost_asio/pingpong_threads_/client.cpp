@@ -19,43 +19,88 @@
 #include <boost/bind.hpp>
 #include <boost/mem_fn.hpp>
 
+#include <getopt.h>
 #ifndef WIN32
 #    include <sys/resource.h>
 #endif
 
+#include <netbench/stats.h>
+
 #include "server.hpp"
 
 class stats
 {
 public:
-    stats(int timeout) : mutex_(), total_bytes_written_(0), total_bytes_read_(0), timeout_(timeout) { }
-
-    void add(size_t bytes_written, size_t bytes_read)
+    stats(size_t block_size, size_t client_threads, server_topology topology, size_t server_threads, int timeout)
+        : block_size_(block_size)
+        , client_threads_(client_threads)
+        , topology_(topology)
+        , server_threads_(server_threads)
+        , timeout_(timeout)
     {
-        asio::detail::mutex::scoped_lock lock(mutex_);
-        total_bytes_written_ += bytes_written;
-        total_bytes_read_ += bytes_read;
+        if (nb_stats_init(&stats_, client_threads) == -1)
+        {
+            throw std::bad_alloc();
+        }
     }
 
+    ~stats() { nb_stats_free(&stats_); }
+
+    // per-thread counters, must be updated only from one thread
+    nb_stats_slot * slot(size_t idx) { return nb_stats_get_slot(&stats_, idx); }
+
     void print()
     {
-        asio::detail::mutex::scoped_lock lock(mutex_);
-        std::cout << total_bytes_written_ << " total bytes written\n";
-        std::cout << total_bytes_read_ << " total bytes read\n";
-        std::cout << static_cast<double>(total_bytes_read_) / (timeout_ * 1024 * 1024) << " MiB/s throughput\n";
+        nb_counters c;
+
+        nb_stats_snapshot(&stats_, &c, nullptr);
+
+        printf(
+            "%20s %8s %8s %8s %8s %6s %18s %18s %10s %12s %18s %18s\n",
+            "Write buffer (bytes)",
+            "Clients",
+            "Threads",
+            "Topology",
+            "Servers",
+            "Errors",
+            "Avg messages size",
+            "Throughtput: MiB/s",
+            "Msg/s",
+            "us/msg",
+            "Total read: bytes",
+            "messages");
+        printf(
+            "%20zd %8zd %8zd %8s %8zd %6zd %18.3f %18.3f %10ld %12.3f %18zd %18zd\n",
+            block_size_,
+            (size_t)c.sessions,
+            client_threads_,
+            server_threads_ ? server_topology_name(topology_) : "-",
+            server_threads_,
+            (size_t)c.errors,
+            (double)c.bytes_read / (double)c.reads,
+            (double)c.bytes_read / (timeout_ * 1024 * 1024),
+            (long)c.reads / timeout_,
+            (double)100000 * timeout_ / (double)c.reads,
+            (size_t)c.bytes_read,
+            (size_t)c.reads);
     }
 
 private:
-    asio::detail::mutex mutex_;
-    size_t total_bytes_written_;
-    size_t total_bytes_read_;
+    nb_stats stats_;
+    size_t block_size_;
+    size_t client_threads_;
+    server_topology topology_;
+    size_t server_threads_; // 0 for external server
     int timeout_;
 };
 
+// counters of the thread, running client io_context (sessions are not bound to one thread)
+static thread_local nb_stats_slot * thread_slot = nullptr;
+
 class session
 {
 public:
-    session(asio::io_service & ios, size_t block_size, stats & s)
+    session(asio::io_service & ios, size_t block_size)
         : strand_(ios)
         , socket_(ios)
         , block_size_(block_size)
@@ -63,9 +108,6 @@ public:
         , read_data_length_(0)
         , write_data_(new char[block_size])
         , unwritten_count_(0)
-        , bytes_written_(0)
-        , bytes_read_(0)
-        , stats_(s)
     {
         for (size_t i = 0; i < block_size_; ++i)
             write_data_[i] = static_cast<char>(i % 128);
@@ -73,8 +115,6 @@ public:
 
     ~session()
     {
-        stats_.add(bytes_written_, bytes_read_);
-
         delete[] read_data_;
         delete[] write_data_;
     }
@@ -98,6 +138,7 @@ private:
             socket_.set_option(no_delay, set_option_err);
             if (!set_option_err)
             {
+                nb_stats_session(thread_slot);
                 ++unwritten_count_;
                 async_write(
                     socket_,
@@ -125,7 +166,7 @@ private:
     {
         if (!err)
         {
-            bytes_read_ += length;
+            nb_stats_read(thread_slot, length);
 
             read_data_length_ = length;
             ++unwritten_count_;
@@ -151,7 +192,7 @@ private:
     {
         if (!err && length > 0)
         {
-            bytes_written_ += length;
+            nb_stats_write(thread_slot, length);
 
             --unwritten_count_;
             if (unwritten_count_ == 1)
@@ -182,9 +223,6 @@ private:
     size_t read_data_length_;
     char * write_data_;
     int unwritten_count_;
-    size_t bytes_written_;
-    size_t bytes_read_;
-    stats & stats_;
     handler_allocator read_allocator_;
     handler_allocator write_allocator_;
 };
@@ -197,15 +235,18 @@ public:
         const asio::ip::tcp::resolver::iterator endpoint_iterator,
         size_t block_size,
         size_t session_count,
+        size_t thread_count,
+        server_topology topology,
+        size_t server_threads,
         int timeout)
-        : io_service_(ios), stop_timer_(ios), sessions_(), stats_(timeout)
+        : io_service_(ios), stop_timer_(ios), sessions_(), stats_(block_size, thread_count, topology, server_threads, timeout)
     {
         stop_timer_.expires_from_now(boost::posix_time::seconds(timeout));
         stop_timer_.async_wait(boost::bind(&client::handle_timeout, this));
 
         for (size_t i = 0; i < session_count; ++i)
         {
-            session * new_session = new session(io_service_, block_size, stats_);
+            session * new_session = new session(io_service_, block_size);
             new_session->start(endpoint_iterator);
             sessions_.push_back(new_session);
         }
@@ -224,6 +265,8 @@ public:
 
     void handle_timeout() { std::for_each(sessions_.begin(), sessions_.end(), boost::mem_fn(&session::stop)); }
 
+    stats & get_stats() { return stats_; }
+
 private:
     asio::io_service & io_service_;
     asio::deadline_timer stop_timer_;
@@ -231,7 +274,15 @@ private:
     stats stats_;
 };
 
-void server_thread(asio::io_service & ios, unsigned short port, size_t block_size, size_t thread_count);
+static void usage(const char * name)
+{
+    fprintf(stderr, "Usage: %s -p <port> -b <blocksize> ", name);
+    fprintf(stderr, "-n <sessions> -d <time> -t <threads>\n");
+    fprintf(stderr, "  [-a server] (by default, start internal server)\n");
+    fprintf(stderr, "  [-T server_threads] [--topology=shared|sharded] (internal server threading model, default shared)\n");
+    fprintf(stderr, "    shared  - one io_context run on all threads, sessions serialized by strands\n");
+    fprintf(stderr, "    sharded - io_context per thread, accepted sockets handed round-robin to worker io_contexts\n");
+}
 
 int main(int argc, char * argv[])
 {
@@ -245,13 +296,17 @@ int main(int argc, char * argv[])
         int session_count = 0;
         int seconds = 60;
         int thread_count = 1;
+        int server_thread_count = 1;
+        server_topology topology = server_topology::shared;
         int client_start = 0;
         int server_start = 1;
 
+        static struct option long_options[] = {{"topology", required_argument, 0, 'o'}, {0, 0, 0, 0}};
+
 #ifndef WIN32
         struct rlimit rl;
 #endif
-        while ((c = getopt(argc, argv, ":a:b:n:d:t:h")) != -1)
+        while ((c = getopt_long(argc, argv, ":a:p:b:n:d:t:T:h", long_options, NULL)) != -1)
         {
             switch (c)
             {
@@ -271,13 +326,21 @@ int main(int argc, char * argv[])
                 case 't':
                     thread_count = atoi(optarg);
                     break;
+                case 'T':
+                    server_thread_count = atoi(optarg);
+                    break;
+                case 'o':
+                    if (!server_topology_parse(optarg, topology))
+                    {
+                        fprintf(stderr, "Invalid topology \"%s\"\n", optarg);
+                        exit(1);
+                    }
+                    break;
                 case 'd':
                     seconds = atoi(optarg);
                     break;
                 case 'h': {
-                    fprintf(stderr, "Usage: %s -p <port> -b <blocksize> ", argv[0]);
-                    fprintf(stderr, "-n <sessions> -d <time>\n");
-                    fprintf(stderr, "  [-a server] (by default, start internal server)\n");
+                    usage(argv[0]);
                     exit(1);
                 }
                 default:
@@ -317,6 +380,11 @@ int main(int argc, char * argv[])
             fprintf(stderr, "Invalid options, nothing started\n");
             return 1;
         }
+        if (server_thread_count <= 0)
+        {
+            fprintf(stderr, "Invalid server threads\n");
+            return 1;
+        }
 
         signal(SIGPIPE, SIG_IGN);
 
@@ -329,28 +397,19 @@ int main(int argc, char * argv[])
         }
 #endif
 
-        service_runner * server = nullptr;
+        std::unique_ptr<server_threads> server;
         if (server_start)
         {
-            server = new service_runner(thread_count);
+            server.reset(new server_threads(topology, static_cast<size_t>(server_thread_count)));
             if (client_start)
             {
-                thread_server = new asio::thread(
-                    server_start,
-                    std::ref(ios_server),
-                    static_cast<unsigned short>(port),
-                    static_cast<size_t>(block_size),
-                    static_cast<size_t>(thread_count));
-                sleep(1);
+                // acceptor is listen on return, no wait needed
+                server->start(static_cast<unsigned short>(port), static_cast<size_t>(block_size));
             }
             else
             {
-                server_thread(
-                    std::ref(ios_server),
-                    static_cast<unsigned short>(port),
-                    static_cast<size_t>(block_size),
-                    static_cast<size_t>(thread_count));
-                exit(0);
+                server->run(static_cast<unsigned short>(port), static_cast<size_t>(block_size));
+                return 0;
             }
         }
 
@@ -361,33 +420,36 @@ int main(int argc, char * argv[])
             asio::ip::tcp::resolver r(ios);
             asio::ip::tcp::resolver::iterator iter = r.resolve(asio::ip::tcp::resolver::query(host, port_str));
 
-            client cl(ios, iter, block_size, session_count, seconds);
-
-            std::list<asio::thread *> threads;
-            while (--thread_count > 0)
+            client cl(
+                ios,
+                iter,
+                block_size,
+                session_count,
+                static_cast<size_t>(thread_count),
+                topology,
+                server ? server->size() : 0,
+                seconds);
+
+            boost::thread_group threads;
+            for (int i = 1; i < thread_count; ++i)
             {
-                asio::thread * new_thread = new asio::thread(boost::bind(&asio::io_service::run, &ios));
-                threads.push_back(new_thread);
+                nb_stats_slot * slot = cl.get_stats().slot(static_cast<size_t>(i));
+                threads.create_thread([&ios, slot]() {
+                    thread_slot = slot;
+                    ios.run();
+                });
             }
 
+            thread_slot = cl.get_stats().slot(0);
             ios.run();
 
-            while (!threads.empty())
-            {
-                threads.front()->join();
-                delete threads.front();
-                threads.pop_front();
-            }
+            threads.join_all();
         }
 
-        if (server_start)
+        if (server)
         {
-            if (thread_server)
-            {
-                ios_server.stop();
-                thread_server->join();
-                delete thread_server;
-            }
+            server->stop();
+            server->join();
         }
     }
     catch (std::exception & e)
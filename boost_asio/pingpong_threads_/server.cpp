@@ -11,176 +11,232 @@
 #include "pch.h" // precompiled header, add other headers after
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <list>
 #include "asio.hpp"
-#include "handler_allocator.hpp"
 #include <boost/bind.hpp>
 
 #include "server.hpp"
 
-class session
+const char * server_topology_name(server_topology topology)
 {
-public:
-    session(asio::io_service & ios, size_t block_size)
-        : io_service_(ios)
-        , strand_(ios)
-        , socket_(ios)
-        , block_size_(block_size)
-        , read_data_(new char[block_size])
-        , read_data_length_(0)
-        , write_data_(new char[block_size])
-        , unsent_count_(0)
-        , op_count_(0)
+    switch (topology)
     {
+        case server_topology::shared:
+            return "shared";
+        case server_topology::sharded:
+            return "sharded";
     }
+    return "unknown";
+}
 
-    ~session()
+bool server_topology_parse(const char * name, server_topology & topology)
+{
+    if (strcmp(name, "shared") == 0)
     {
-        delete[] read_data_;
-        delete[] write_data_;
+        topology = server_topology::shared;
     }
+    else if (strcmp(name, "sharded") == 0)
+    {
+        topology = server_topology::sharded;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
 
-    asio::ip::tcp::socket & socket() { return socket_; }
+// Session handlers are dispatched through Executor: strand for shared io_context, io_context executor for sharded
+template <class Executor>
+class session : public std::enable_shared_from_this<session<Executor>>
+{
+public:
+    session(asio::ip::tcp::socket socket, const Executor & executor, size_t block_size)
+        : socket_(std::move(socket)), executor_(executor), block_size_(block_size), data_(new char[block_size])
+    {
+    }
+
+    ~session() { delete[] data_; }
 
     void start()
     {
         asio::error_code set_option_err;
         asio::ip::tcp::no_delay no_delay(true);
         socket_.set_option(no_delay, set_option_err);
+
         if (!set_option_err)
         {
-            ++op_count_;
-            socket_.async_read_some(
-                asio::buffer(read_data_, block_size_),
-                strand_.wrap(make_custom_alloc_handler(
-                    read_allocator_,
-                    boost::bind(&session::handle_read, this, asio::placeholders::error, asio::placeholders::bytes_transferred))));
-        }
-        else
-        {
-            io_service_.post(boost::bind(&session::destroy, this));
+            do_read();
         }
     }
 
-    void handle_read(const asio::error_code & err, size_t length)
+private:
+    void do_read()
     {
-        --op_count_;
-
-        if (!err)
-        {
-            read_data_length_ = length;
-            ++unsent_count_;
-            if (unsent_count_ == 1)
-            {
-                op_count_ += 2;
-                std::swap(read_data_, write_data_);
-                async_write(
-                    socket_,
-                    asio::buffer(write_data_, read_data_length_),
-                    strand_.wrap(
-                        make_custom_alloc_handler(write_allocator_, boost::bind(&session::handle_write, this, asio::placeholders::error))));
-                socket_.async_read_some(
-                    asio::buffer(read_data_, block_size_),
-                    strand_.wrap(make_custom_alloc_handler(
-                        read_allocator_,
-                        boost::bind(&session::handle_read, this, asio::placeholders::error, asio::placeholders::bytes_transferred))));
-            }
-        }
-
-        if (op_count_ == 0)
-            io_service_.post(boost::bind(&session::destroy, this));
+        auto self(this->shared_from_this());
+        socket_.async_read_some(
+            asio::buffer(data_, block_size_), asio::bind_executor(executor_, [this, self](asio::error_code ec, std::size_t length) {
+                if (!ec)
+                {
+                    do_write(length);
+                }
+            }));
     }
 
-    void handle_write(const asio::error_code & err)
+    void do_write(std::size_t length)
     {
-        --op_count_;
-
-        if (!err)
-        {
-            --unsent_count_;
-            if (unsent_count_ == 1)
-            {
-                op_count_ += 2;
-                std::swap(read_data_, write_data_);
-                async_write(
-                    socket_,
-                    asio::buffer(write_data_, read_data_length_),
-                    strand_.wrap(
-                        make_custom_alloc_handler(write_allocator_, boost::bind(&session::handle_write, this, asio::placeholders::error))));
-                socket_.async_read_some(
-                    asio::buffer(read_data_, block_size_),
-                    strand_.wrap(make_custom_alloc_handler(
-                        read_allocator_,
-                        boost::bind(&session::handle_read, this, asio::placeholders::error, asio::placeholders::bytes_transferred))));
-            }
-        }
-
-        if (op_count_ == 0)
-            io_service_.post(boost::bind(&session::destroy, this));
+        auto self(this->shared_from_this());
+        asio::async_write(
+            socket_, asio::buffer(data_, length), asio::bind_executor(executor_, [this, self](asio::error_code ec, std::size_t /*length*/) {
+                if (!ec)
+                {
+                    do_read();
+                }
+            }));
     }
 
-    static void destroy(session * s) { delete s; }
-
-private:
-    asio::io_service & io_service_;
-    asio::io_service::strand strand_;
     asio::ip::tcp::socket socket_;
+    Executor executor_;
     size_t block_size_;
-    char * read_data_;
-    size_t read_data_length_;
-    char * write_data_;
-    int unsent_count_;
-    int op_count_;
-    handler_allocator read_allocator_;
-    handler_allocator write_allocator_;
+    char * data_;
 };
 
+typedef session<asio::strand<asio::io_context::executor_type>> strand_session;
+typedef session<asio::io_context::executor_type> local_session;
+
 class server
 {
 public:
-    server(asio::io_service & ios, const asio::ip::tcp::endpoint & endpoint, size_t block_size)
-        : io_service_(ios), acceptor_(ios), block_size_(block_size)
+    // workers is empty for shared topology, accepted sockets stay on acceptor io_context
+    server(
+        asio::io_context & ios, std::vector<asio::io_context *> workers, const asio::ip::tcp::endpoint & endpoint, size_t block_size)
+        : io_context_(ios), acceptor_(ios), workers_(std::move(workers)), next_worker_(0), block_size_(block_size)
     {
         acceptor_.open(endpoint.protocol());
         acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(1));
         acceptor_.bind(endpoint);
         acceptor_.listen();
 
-        session * new_session = new session(io_service_, block_size_);
-        acceptor_.async_accept(new_session->socket(), boost::bind(&server::handle_accept, this, new_session, asio::placeholders::error));
-    }
-
-    void handle_accept(session * new_session, const asio::error_code & err)
-    {
-        if (!err)
+        if (workers_.empty())
         {
-            new_session->start();
-            new_session = new session(io_service_, block_size_);
-            acceptor_.async_accept(
-                new_session->socket(), boost::bind(&server::handle_accept, this, new_session, asio::placeholders::error));
+            do_accept();
         }
         else
         {
-            delete new_session;
+            do_accept_handoff();
         }
     }
 
 private:
-    asio::io_service & io_service_;
+    void do_accept()
+    {
+        acceptor_.async_accept([this](asio::error_code ec, asio::ip::tcp::socket socket) {
+            if (!ec)
+            {
+                auto strand = asio::make_strand(io_context_);
+                std::make_shared<strand_session>(std::move(socket), strand, block_size_)->start();
+            }
+
+            if (ec != asio::error::operation_aborted)
+            {
+                do_accept();
+            }
+        });
+    }
+
+    void do_accept_handoff()
+    {
+        asio::io_context & worker = *workers_[next_worker_];
+        next_worker_ = (next_worker_ + 1) % workers_.size();
+
+        // socket is bound to worker io_context, start is posted into the worker thread
+        acceptor_.async_accept(worker, [this, &worker](asio::error_code ec, asio::ip::tcp::socket socket) {
+            if (!ec)
+            {
+                auto s = std::make_shared<local_session>(std::move(socket), worker.get_executor(), block_size_);
+                asio::post(worker, [s]() { s->start(); });
+            }
+
+            if (ec != asio::error::operation_aborted)
+            {
+                do_accept_handoff();
+            }
+        });
+    }
+
+    asio::io_context & io_context_;
     asio::ip::tcp::acceptor acceptor_;
+    std::vector<asio::io_context *> workers_;
+    size_t next_worker_;
     size_t block_size_;
 };
 
-// private:
-//     asio::io_service ios_;
-//     asio::executor_work_guard<asio::io_context::executor_type> ios_work_;
-//     size_t thread_count_;
-//     boost::thread_group thread_group_;
-// };
+server_threads::server_threads(server_topology topology, size_t thread_count) : topology_(topology), thread_count_(thread_count)
+{
+    if (topology_ == server_topology::shared)
+    {
+        runners_.emplace_back(new service_runner(thread_count_));
+    }
+    else
+    {
+        for (size_t i = 0; i < thread_count_; ++i)
+        {
+            runners_.emplace_back(new service_runner(1));
+        }
+    }
+}
 
-void server_thread(asio::io_service & ios, unsigned short port, size_t block_size, size_t thread_count)
+server_threads::~server_threads()
 {
-    server s(ios, asio::ip::tcp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), block_size);
-    ios.run();
+    stop();
+    join();
+}
+
+void server_threads::start(unsigned short port, size_t block_size)
+{
+    std::vector<asio::io_context *> workers;
+    if (topology_ == server_topology::sharded)
+    {
+        for (auto & runner : runners_)
+        {
+            workers.push_back(&runner->io_context());
+        }
+    }
+    // acceptor is listen before threads started, so clients can connect immediately
+    server_.reset(new server(
+        runners_[0]->io_context(),
+        std::move(workers),
+        asio::ip::tcp::endpoint(asio::ip::address::from_string("127.0.0.1"), port),
+        block_size));
+
+    for (auto & runner : runners_)
+    {
+        runner->start();
+    }
+}
+
+void server_threads::run(unsigned short port, size_t block_size)
+{
+    start(port, block_size);
+    join();
+}
+
+void server_threads::stop()
+{
+    for (auto & runner : runners_)
+    {
+        runner->stop();
+    }
+}
+
+void server_threads::join()
+{
+    for (auto & runner : runners_)
+    {
+        runner->join();
+    }
+    // sessions are owned by pending handlers, destroyed with io_context
+    server_.reset();
 }
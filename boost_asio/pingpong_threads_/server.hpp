@@ -1,23 +1,49 @@
 #ifndef _SERVER_HPP
 #define _SERVER_HPP
 
+#include <memory>
+#include <vector>
+
 #include "asio.hpp"
 
+enum class server_topology
+{
+    shared, // one io_context, run on all threads, sessions serialized by strands
+    sharded // io_context per thread, one acceptor hands accepted sockets round-robin to worker contexts
+};
+
+const char * server_topology_name(server_topology topology);
+
+bool server_topology_parse(const char * name, server_topology & topology);
+
+class server;
+
 struct service_runner
 {
 public:
-    service_runner(size_t thread_count) : thread_count_(thread_count), ios_(), ios_work_(asio::make_work_guard(ios_))
+    service_runner(size_t thread_count) : thread_count_(thread_count), ios_(), ios_work_(asio::make_work_guard(ios_)) { }
+
+    ~service_runner()
     {
-        for (size_t i = 0; i < thread_count; ++i)
-        {
-            thread_group_.add_thread(new boost::thread(boost::bind(&asio::io_service::run, &ios_)));
-        }
+        stop();
+        join();
     }
 
+    asio::io_context & io_context() { return ios_; }
+
     template <class F>
     void enqueue(F f)
     {
-        ios_.post(f);
+        asio::post(ios_, f);
+    }
+
+    // start thread_count threads for run io_context
+    void start()
+    {
+        for (size_t i = 0; i < thread_count_; ++i)
+        {
+            thread_group_.create_thread(boost::bind(&asio::io_context::run, &ios_));
+        }
     }
 
     void run() { ios_.run(); }
@@ -25,16 +51,45 @@ public:
     void stop()
     {
         ios_work_.reset();
-        thread_group_.join_all();
+        ios_.stop();
     }
 
-    ~server_thread_group() { stop(); }
+    void join() { thread_group_.join_all(); }
 
 private:
+    size_t thread_count_;
     asio::io_context ios_;
     asio::executor_work_guard<asio::io_context::executor_type> ios_work_;
-    size_t thread_count_;
     boost::thread_group thread_group_;
-}
+};
+
+class server_threads
+{
+public:
+    server_threads(server_topology topology, size_t thread_count);
+
+    ~server_threads();
+
+    server_topology topology() const { return topology_; }
+
+    size_t size() const { return thread_count_; }
+
+    // start server in background threads
+    void start(unsigned short port, size_t block_size);
+
+    // start server and wait for stop
+    void run(unsigned short port, size_t block_size);
+
+    void stop();
+
+    void join();
+
+private:
+    server_topology topology_;
+    size_t thread_count_;
+    // shared: one runner with thread_count threads, sharded: thread_count runners with one thread
+    std::vector<std::unique_ptr<service_runner>> runners_;
+    std::unique_ptr<server> server_;
+};
 
 #endif /* _SERVER_HPP */
@@ -0,0 +1,221 @@
+/*
+ * CPU affinity and NUMA placement of event loop threads
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <netbench/affinity.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/mempolicy.h>
+
+#define MAX_NODES 1024
+
+static int cpus_add(struct nb_cpus * c, int cpu, size_t * capacity)
+{
+    if (c->count == *capacity)
+    {
+        size_t n = *capacity ? *capacity * 2 : 16;
+        int * cpus = realloc(c->cpus, n * sizeof(int));
+        if (cpus == NULL)
+        {
+            return -1;
+        }
+        c->cpus = cpus;
+        *capacity = n;
+    }
+    c->cpus[c->count++] = cpu;
+    return 0;
+}
+
+int nb_cpus_parse(struct nb_cpus * c, const char * list)
+{
+    cpu_set_t allowed;
+    size_t capacity = 0;
+    const char * p = list;
+
+    c->cpus = NULL;
+    c->count = 0;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1)
+    {
+        perror("sched_getaffinity");
+        return -1;
+    }
+    while (*p)
+    {
+        char * end;
+        long first, last, cpu;
+
+        first = strtol(p, &end, 10);
+        if (end == p || first < 0)
+        {
+            goto invalid;
+        }
+        last = first;
+        p = end;
+        if (*p == '-')
+        {
+            ++p;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first)
+            {
+                goto invalid;
+            }
+            p = end;
+        }
+        for (cpu = first; cpu <= last; ++cpu)
+        {
+            if (cpu >= CPU_SETSIZE || !CPU_ISSET((size_t)cpu, &allowed))
+            {
+                fprintf(stderr, "CPU %ld is not available\n", cpu);
+                nb_cpus_free(c);
+                return -1;
+            }
+            if (cpus_add(c, (int)cpu, &capacity) == -1)
+            {
+                nb_cpus_free(c);
+                return -1;
+            }
+        }
+        if (*p == ',')
+        {
+            ++p;
+        }
+        else if (*p)
+        {
+            goto invalid;
+        }
+    }
+    if (c->count == 0)
+    {
+        goto invalid;
+    }
+    return 0;
+
+invalid:
+    fprintf(stderr, "Invalid CPU list \"%s\"\n", list);
+    nb_cpus_free(c);
+    return -1;
+}
+
+void nb_cpus_free(struct nb_cpus * c)
+{
+    free(c->cpus);
+    c->cpus = NULL;
+    c->count = 0;
+}
+
+int nb_cpu_node(int cpu)
+{
+    char path[64];
+    DIR * dir;
+    struct dirent * e;
+    int node = -1;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    dir = opendir(path);
+    if (dir == NULL)
+    {
+        return -1;
+    }
+    while ((e = readdir(dir)) != NULL)
+    {
+        char * end;
+        long n;
+        if (strncmp(e->d_name, "node", 4) != 0)
+        {
+            continue;
+        }
+        n = strtol(e->d_name + 4, &end, 10);
+        if (end != e->d_name + 4 && *end == '\0')
+        {
+            node = (int)n;
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+int nb_thread_place(int cpu)
+{
+    cpu_set_t set;
+    int node;
+    int err;
+
+    if (cpu < 0)
+    {
+        return 0;
+    }
+    CPU_ZERO(&set);
+    CPU_SET((size_t)cpu, &set);
+    err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0)
+    {
+        fprintf(stderr, "Pin to CPU %d: %s\n", cpu, strerror(err));
+        return -1;
+    }
+
+    /* preferred, not bind: allocation falls back to other nodes instead of failing when local node is full */
+    node = nb_cpu_node(cpu);
+    if (node >= 0 && node < MAX_NODES)
+    {
+        unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))];
+        memset(mask, 0, sizeof(mask));
+        mask[(size_t)node / (8 * sizeof(unsigned long))] |= 1UL << ((size_t)node % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, (unsigned long)MAX_NODES + 1) == -1 && errno != ENOSYS)
+        {
+            fprintf(stderr, "Set memory policy to node %d: %s\n", node, strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void nb_cpus_nodes(const struct nb_cpus * c, size_t threads, char * buf, size_t size)
+{
+    char seen[MAX_NODES];
+    size_t i, len = 0;
+    int node;
+
+    if (size == 0)
+    {
+        return;
+    }
+    if (c->count == 0)
+    {
+        snprintf(buf, size, "-");
+        return;
+    }
+    memset(seen, 0, sizeof(seen));
+    for (i = 0; i < threads; ++i)
+    {
+        node = nb_cpu_node(nb_cpus_get(c, i));
+        if (node >= 0 && node < MAX_NODES)
+        {
+            seen[node] = 1;
+        }
+    }
+    buf[0] = '\0';
+    for (node = 0; node < MAX_NODES; ++node)
+    {
+        if (seen[node] && len < size)
+        {
+            len += (size_t)snprintf(buf + len, size - len, "%s%d", len ? "," : "", node);
+        }
+    }
+    if (len == 0)
+    {
+        snprintf(buf, size, "?");
+    }
+}
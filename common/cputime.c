@@ -0,0 +1,158 @@
+/*
+ * CPU time and context switches of event loop threads
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <netbench/cputime.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int nb_cputime_init(struct nb_cputime * t)
+{
+    t->threads = NULL;
+    t->count = 0;
+    t->capacity = 0;
+    return pthread_mutex_init(&t->lock, NULL) == 0 ? 0 : -1;
+}
+
+void nb_cputime_free(struct nb_cputime * t)
+{
+    free(t->threads);
+    t->threads = NULL;
+    t->count = 0;
+    pthread_mutex_destroy(&t->lock);
+}
+
+void nb_cputime_attach(struct nb_cputime * t)
+{
+    struct nb_cputime_thread thread;
+
+    thread.tid = (pid_t)syscall(SYS_gettid);
+    if (pthread_getcpuclockid(pthread_self(), &thread.clock) != 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&t->lock);
+    if (t->count == t->capacity)
+    {
+        size_t n = t->capacity ? t->capacity * 2 : 8;
+        struct nb_cputime_thread * threads = realloc(t->threads, n * sizeof(*threads));
+        if (threads == NULL)
+        {
+            pthread_mutex_unlock(&t->lock);
+            return;
+        }
+        t->threads = threads;
+        t->capacity = n;
+    }
+    t->threads[t->count++] = thread;
+    pthread_mutex_unlock(&t->lock);
+}
+
+/* utime and stime fields of /proc stat file of thread or process, in clock ticks */
+static int read_stat(const char * path, struct nb_cputime_values * v, uint64_t ns_per_tick)
+{
+    char buf[1024];
+    char * p;
+    unsigned long utime, stime;
+    size_t len;
+    FILE * f;
+
+    f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[len] = '\0';
+
+    /* comm may contain spaces and parentheses */
+    p = strrchr(buf, ')');
+    if (p && sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) == 2)
+    {
+        v->user_ns += (uint64_t)utime * ns_per_tick;
+        v->sys_ns += (uint64_t)stime * ns_per_tick;
+        return 0;
+    }
+    return -1;
+}
+
+static void read_status(pid_t tid, struct nb_cputime_values * v)
+{
+    char path[64];
+    char line[256];
+    unsigned long n;
+    FILE * f;
+
+    snprintf(path, sizeof(path), "/proc/self/task/%d/status", (int)tid);
+    f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "voluntary_ctxt_switches: %lu", &n) == 1)
+        {
+            v->voluntary_cs += n;
+        }
+        else if (sscanf(line, "nonvoluntary_ctxt_switches: %lu", &n) == 1)
+        {
+            v->involuntary_cs += n;
+        }
+    }
+    fclose(f);
+}
+
+void nb_cputime_read(struct nb_cputime * t, struct nb_cputime_values * v)
+{
+    uint64_t ns_per_tick = 1000000000ULL / (uint64_t)sysconf(_SC_CLK_TCK);
+    size_t i;
+
+    memset(v, 0, sizeof(*v));
+    pthread_mutex_lock(&t->lock);
+    for (i = 0; i < t->count; ++i)
+    {
+        char path[64];
+        struct timespec ts;
+        if (clock_gettime(t->threads[i].clock, &ts) == 0)
+        {
+            v->cpu_ns += (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+        }
+        snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int)t->threads[i].tid);
+        read_stat(path, v, ns_per_tick);
+        read_status(t->threads[i].tid, v);
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+void nb_cputime_diff(struct nb_cputime_values * dst, const struct nb_cputime_values * cur, const struct nb_cputime_values * prev)
+{
+    dst->cpu_ns = cur->cpu_ns - prev->cpu_ns;
+    dst->user_ns = cur->user_ns - prev->user_ns;
+    dst->sys_ns = cur->sys_ns - prev->sys_ns;
+    dst->voluntary_cs = cur->voluntary_cs - prev->voluntary_cs;
+    dst->involuntary_cs = cur->involuntary_cs - prev->involuntary_cs;
+}
+
+int nb_cputime_read_process(pid_t pid, struct nb_cputime_values * v)
+{
+    char path[64];
+    uint64_t ns_per_tick = 1000000000ULL / (uint64_t)sysconf(_SC_CLK_TCK);
+
+    memset(v, 0, sizeof(*v));
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    if (read_stat(path, v, ns_per_tick) == -1)
+    {
+        return -1;
+    }
+    v->cpu_ns = v->user_ns + v->sys_ns;
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * CRC32C (Castagnoli)
+ */
+#include <netbench/crc32c.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CRC32C_POLY 0x82F63B78U /* reflected */
+
+static uint32_t crc32c_table[256];
+
+static uint32_t crc32c_scalar(uint32_t state, const void * data, size_t size)
+{
+    const unsigned char * p = data;
+    while (size--)
+    {
+        state = crc32c_table[(state ^ *p++) & 0xFF] ^ (state >> 8);
+    }
+    return state;
+}
+
+#if defined(__x86_64__)
+#    include <nmmintrin.h>
+
+__attribute__((target("sse4.2"))) static uint32_t crc32c_sse42(uint32_t state, const void * data, size_t size)
+{
+    const unsigned char * p = data;
+    uint64_t state64 = state;
+    uint64_t v;
+    while (size && ((uintptr_t)p & 7))
+    {
+        state64 = _mm_crc32_u8((uint32_t)state64, *p++);
+        --size;
+    }
+    while (size >= 8)
+    {
+        memcpy(&v, p, 8);
+        state64 = _mm_crc32_u64(state64, v);
+        p += 8;
+        size -= 8;
+    }
+    while (size--)
+    {
+        state64 = _mm_crc32_u8((uint32_t)state64, *p++);
+    }
+    return (uint32_t)state64;
+}
+#endif
+
+typedef uint32_t (*crc32c_fn)(uint32_t state, const void * data, size_t size);
+
+static const char * crc32c_name;
+static crc32c_fn crc32c_impl;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+/* NB_CRC32C=scalar environment variable forces table driven implementation (to compare cost) */
+static void crc32c_select(void)
+{
+    uint32_t i, j, c;
+    const char * force = getenv("NB_CRC32C");
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2") && (force == NULL || strcmp(force, "scalar") != 0))
+    {
+        crc32c_name = "sse4.2";
+        crc32c_impl = crc32c_sse42;
+        return;
+    }
+#endif
+    for (i = 0; i < 256; ++i)
+    {
+        c = i;
+        for (j = 0; j < 8; ++j)
+        {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        }
+        crc32c_table[i] = c;
+    }
+    crc32c_name = "scalar";
+    crc32c_impl = crc32c_scalar;
+}
+
+/* table is filled once, before any thread can use it */
+static crc32c_fn crc32c_get(void)
+{
+    pthread_once(&crc32c_once, crc32c_select);
+    return crc32c_impl;
+}
+
+uint32_t nb_crc32c_update(uint32_t state, const void * data, size_t size)
+{
+    return crc32c_get()(state, data, size);
+}
+
+const char * nb_crc32c_impl(void)
+{
+    crc32c_get();
+    return crc32c_name;
+}
@@ -0,0 +1,132 @@
+/*
+ * Fixed memory log-linear (HDR-style) histogram
+ */
+#include <netbench/histogram.h>
+
+#include <string.h>
+
+void nb_histogram_init(struct nb_histogram * h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+/* Highest value in bucket */
+static uint64_t bucket_highest(size_t idx)
+{
+    unsigned shift;
+    uint64_t sub;
+    if (idx < NB_HISTOGRAM_SUB_COUNT)
+    {
+        return idx;
+    }
+    shift = (unsigned)((idx - NB_HISTOGRAM_SUB_COUNT) / NB_HISTOGRAM_HALF_COUNT) + 1;
+    sub = (idx - NB_HISTOGRAM_SUB_COUNT) % NB_HISTOGRAM_HALF_COUNT + NB_HISTOGRAM_HALF_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+/* Lowest value in bucket */
+static uint64_t bucket_lowest(size_t idx)
+{
+    unsigned shift;
+    uint64_t sub;
+    if (idx < NB_HISTOGRAM_SUB_COUNT)
+    {
+        return idx;
+    }
+    shift = (unsigned)((idx - NB_HISTOGRAM_SUB_COUNT) / NB_HISTOGRAM_HALF_COUNT) + 1;
+    sub = (idx - NB_HISTOGRAM_SUB_COUNT) % NB_HISTOGRAM_HALF_COUNT + NB_HISTOGRAM_HALF_COUNT;
+    return sub << shift;
+}
+
+void nb_histogram_diff(struct nb_histogram * dst, const struct nb_histogram * cur, const struct nb_histogram * prev)
+{
+    size_t i;
+    nb_histogram_init(dst);
+    for (i = 0; i < NB_HISTOGRAM_BUCKETS; ++i)
+    {
+        dst->counts[i] = cur->counts[i] - prev->counts[i];
+        if (dst->counts[i])
+        {
+            /* exact min/max are lost, use bounds of lowest and highest used buckets */
+            if (dst->min == UINT64_MAX)
+            {
+                dst->min = bucket_lowest(i) > cur->min ? bucket_lowest(i) : cur->min;
+            }
+            dst->max = bucket_highest(i) < cur->max ? bucket_highest(i) : cur->max;
+        }
+    }
+    dst->count = cur->count - prev->count;
+    dst->sum = cur->sum - prev->sum;
+}
+
+void nb_histogram_merge(struct nb_histogram * dst, const struct nb_histogram * src)
+{
+    size_t i;
+    if (src->count == 0)
+    {
+        return;
+    }
+    for (i = 0; i < NB_HISTOGRAM_BUCKETS; ++i)
+    {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min)
+    {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max)
+    {
+        dst->max = src->max;
+    }
+}
+
+uint64_t nb_histogram_percentile(const struct nb_histogram * h, double percentile)
+{
+    uint64_t rank, seen = 0;
+    size_t i;
+    uint64_t value;
+    if (h->count == 0)
+    {
+        return 0;
+    }
+    if (percentile >= 100.0)
+    {
+        return h->max;
+    }
+    rank = (uint64_t)(percentile / 100.0 * (double)h->count + 0.5);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+    for (i = 0; i < NB_HISTOGRAM_BUCKETS; ++i)
+    {
+        seen += h->counts[i];
+        if (seen >= rank)
+        {
+            value = bucket_highest(i);
+            /* bucket bounds can't be outside of recorded values */
+            if (value > h->max)
+            {
+                value = h->max;
+            }
+            if (value < h->min)
+            {
+                value = h->min;
+            }
+            return value;
+        }
+    }
+    return h->max;
+}
+
+double nb_histogram_mean(const struct nb_histogram * h)
+{
+    if (h->count == 0)
+    {
+        return 0.0;
+    }
+    return (double)h->sum / (double)h->count;
+}
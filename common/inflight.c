@@ -0,0 +1,29 @@
+/*
+ * Per-session FIFO of messages in flight
+ */
+#include <netbench/inflight.h>
+
+#include <stdlib.h>
+
+int nb_inflight_init(struct nb_inflight * q, size_t capacity)
+{
+    q->head = 0;
+    q->count = 0;
+    q->received = 0;
+    q->msgs = malloc(capacity * sizeof(struct nb_inflight_msg));
+    if (q->msgs == NULL)
+    {
+        q->capacity = 0;
+        return -1;
+    }
+    q->capacity = capacity;
+    return 0;
+}
+
+void nb_inflight_free(struct nb_inflight * q)
+{
+    free(q->msgs);
+    q->msgs = NULL;
+    q->capacity = 0;
+    q->count = 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * Hardware performance counters of event loop threads
+ */
+#include <netbench/perf.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/perf_event.h>
+
+static const struct
+{
+    uint32_t type;
+    uint64_t config;
+} counters[NB_PERF_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {PERF_TYPE_TRACEPOINT, 0}, /* id is read from tracefs */
+};
+
+/* raw_syscalls:sys_enter tracepoint id, -1 if tracefs is not mounted */
+static long syscalls_tracepoint(void)
+{
+    static const char * const paths[] = {
+        "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+        "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id",
+    };
+    size_t i;
+    long id = -1;
+    for (i = 0; i < sizeof(paths) / sizeof(paths[0]) && id == -1; ++i)
+    {
+        FILE * f = fopen(paths[i], "r");
+        if (f)
+        {
+            if (fscanf(f, "%ld", &id) != 1)
+            {
+                id = -1;
+            }
+            fclose(f);
+        }
+    }
+    return id;
+}
+
+static int perf_open(int counter, int kernel)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counters[counter].type;
+    attr.config = counters[counter].config;
+    if (counter == NB_PERF_SYSCALLS)
+    {
+        long id = syscalls_tracepoint();
+        if (id == -1)
+        {
+            errno = ENOENT;
+            return -1;
+        }
+        attr.config = (uint64_t)id;
+        /* tracepoint fires in kernel mode */
+        kernel = 1;
+    }
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = kernel ? 0 : 1;
+    attr.exclude_hv = 1;
+    /* calling thread on any CPU */
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int nb_perf_init(struct nb_perf * p, int enabled)
+{
+    p->fds = NULL;
+    p->count = 0;
+    p->capacity = 0;
+    p->enabled = enabled;
+    p->kernel = 1;
+    return pthread_mutex_init(&p->lock, NULL) == 0 ? 0 : -1;
+}
+
+void nb_perf_free(struct nb_perf * p)
+{
+    size_t i;
+    int c;
+    for (i = 0; i < p->count; ++i)
+    {
+        for (c = 0; c < NB_PERF_COUNTERS; ++c)
+        {
+            if (p->fds[i][c] != -1)
+            {
+                close(p->fds[i][c]);
+            }
+        }
+    }
+    free(p->fds);
+    p->fds = NULL;
+    p->count = 0;
+    pthread_mutex_destroy(&p->lock);
+}
+
+void nb_perf_attach(struct nb_perf * p)
+{
+    int c, prev;
+    if (!p->enabled)
+    {
+        return;
+    }
+    pthread_mutex_lock(&p->lock);
+    if (p->count == p->capacity)
+    {
+        size_t n = p->capacity ? p->capacity * 2 : 8;
+        int(*fds)[NB_PERF_COUNTERS] = realloc(p->fds, n * sizeof(*fds));
+        if (fds == NULL)
+        {
+            pthread_mutex_unlock(&p->lock);
+            return;
+        }
+        p->fds = fds;
+        p->capacity = n;
+    }
+    for (c = 0; c < NB_PERF_COUNTERS; ++c)
+    {
+        int fd = perf_open(c, p->kernel);
+        if (fd == -1 && p->kernel && c != NB_PERF_SYSCALLS && (errno == EACCES || errno == EPERM))
+        {
+            /* perf_event_paranoid > 1, user mode only for all threads of group */
+            p->kernel = 0;
+            for (prev = 0; prev < c; ++prev)
+            {
+                if (p->fds[p->count][prev] != -1)
+                {
+                    close(p->fds[p->count][prev]);
+                    p->fds[p->count][prev] = perf_open(prev, 0);
+                }
+            }
+            fd = perf_open(c, 0);
+        }
+        p->fds[p->count][c] = fd;
+    }
+    ++p->count;
+    pthread_mutex_unlock(&p->lock);
+}
+
+void nb_perf_read(struct nb_perf * p, struct nb_perf_values * v)
+{
+    size_t i;
+    int c;
+    memset(v, 0, sizeof(*v));
+    pthread_mutex_lock(&p->lock);
+    for (c = 0; c < NB_PERF_COUNTERS; ++c)
+    {
+        v->valid[c] = p->count > 0;
+    }
+    for (i = 0; i < p->count; ++i)
+    {
+        for (c = 0; c < NB_PERF_COUNTERS; ++c)
+        {
+            uint64_t data[3]; /* value, time enabled, time running */
+            if (p->fds[i][c] == -1 || read(p->fds[i][c], data, sizeof(data)) != (ssize_t)sizeof(data))
+            {
+                v->valid[c] = 0;
+                continue;
+            }
+            if (data[2] == 0)
+            {
+                continue;
+            }
+            v->values[c] += data[2] < data[1] ? (uint64_t)((double)data[0] * (double)data[1] / (double)data[2]) : data[0];
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+void nb_perf_diff(struct nb_perf_values * dst, const struct nb_perf_values * cur, const struct nb_perf_values * prev)
+{
+    int c;
+    for (c = 0; c < NB_PERF_COUNTERS; ++c)
+    {
+        dst->valid[c] = cur->valid[c] && prev->valid[c];
+        dst->values[c] = cur->values[c] - prev->values[c];
+    }
+}
+
+const char * nb_perf_scope(const struct nb_perf * p)
+{
+    size_t i;
+    int c;
+    if (!p->enabled)
+    {
+        return "off";
+    }
+    for (i = 0; i < p->count; ++i)
+    {
+        for (c = 0; c < NB_PERF_COUNTERS; ++c)
+        {
+            if (p->fds[i][c] != -1)
+            {
+                return p->kernel ? "user+kernel" : "user";
+            }
+        }
+    }
+    return "none";
+}
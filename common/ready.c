@@ -0,0 +1,88 @@
+/*
+ * Server readiness notification over a pipe
+ */
+#include <netbench/ready.h>
+
+#include <netbench/clock.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+void nb_ready_notify(int fd, int ok)
+{
+    const char * line = ok ? "ready\n" : "failed\n";
+    if (fd == -1)
+    {
+        return;
+    }
+    /* reader may be gone, SIGPIPE is ignored by benchmarks */
+    if (write(fd, line, strlen(line)) == -1)
+    {
+        perror("ready notification");
+    }
+    close(fd);
+}
+
+int nb_ready_wait(int fd, int timeout_ms)
+{
+    char line[16];
+    size_t len = 0;
+    uint64_t deadline_ns = nb_time_ns() + (uint64_t)timeout_ms * 1000000;
+    int result = -1;
+
+    for (;;)
+    {
+        struct pollfd pfd;
+        uint64_t now = nb_time_ns();
+        ssize_t n;
+        int ready;
+
+        if (now >= deadline_ns)
+        {
+            fprintf(stderr, "Server is not ready after %d ms\n", timeout_ms);
+            break;
+        }
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ready = poll(&pfd, 1, (int)((deadline_ns - now) / 1000000) + 1);
+        if (ready == -1 && errno != EINTR)
+        {
+            perror("poll");
+            break;
+        }
+        if (ready <= 0)
+        {
+            continue;
+        }
+        n = read(fd, line + len, sizeof(line) - 1 - len);
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            fprintf(stderr, "Server exited before it was ready\n");
+            break;
+        }
+        len += (size_t)n;
+        line[len] = '\0';
+        if (strchr(line, '\n') || len == sizeof(line) - 1)
+        {
+            if (strcmp(line, "ready\n") == 0)
+            {
+                result = 0;
+            }
+            else
+            {
+                fprintf(stderr, "Server failed to start\n");
+            }
+            break;
+        }
+    }
+    close(fd);
+    return result;
+}
@@ -0,0 +1,39 @@
+/*
+ * Periodic interval report lines
+ */
+#include <netbench/report.h>
+
+void nb_report_interval_header(FILE * out)
+{
+    fprintf(
+        out,
+        "%10s %8s %6s %18s %10s %10s %10s %10s %10s\n",
+        "Time: s",
+        "Clients",
+        "Errors",
+        "Throughtput: MiB/s",
+        "Msg/s",
+        "p50 us",
+        "p99 us",
+        "p99.9 us",
+        "max us");
+}
+
+void nb_report_interval(
+    FILE * out, uint64_t time_ns, uint64_t elapsed_ns, const struct nb_counters * counters, const struct nb_histogram * latency)
+{
+    double elapsed = (double)elapsed_ns / 1e9;
+    fprintf(
+        out,
+        "%10.3f %8zd %6zd %18.3f %10.0f %10.3f %10.3f %10.3f %10.3f\n",
+        (double)time_ns / 1e9,
+        (size_t)counters->sessions,
+        (size_t)counters->errors,
+        (double)counters->bytes_read / (elapsed * 1024 * 1024),
+        (double)counters->messages / elapsed,
+        (double)nb_histogram_percentile(latency, 50.0) / 1000,
+        (double)nb_histogram_percentile(latency, 99.0) / 1000,
+        (double)nb_histogram_percentile(latency, 99.9) / 1000,
+        (double)nb_histogram_percentile(latency, 100.0) / 1000);
+    fflush(out);
+}
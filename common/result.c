@@ -0,0 +1,322 @@
+/*
+ * Benchmark result record and emitter
+ */
+#include <netbench/result.h>
+
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int nb_format_parse(const char * name, enum nb_format * format)
+{
+    if (strcmp(name, "table") == 0)
+    {
+        *format = NB_FORMAT_TABLE;
+    }
+    else if (strcmp(name, "csv") == 0)
+    {
+        *format = NB_FORMAT_CSV;
+    }
+    else if (strcmp(name, "json") == 0)
+    {
+        *format = NB_FORMAT_JSON;
+    }
+    else
+    {
+        fprintf(stderr, "Invalid format \"%s\", must be table, csv or json\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+void nb_result_init(struct nb_result * r)
+{
+    r->count = 0;
+}
+
+static struct nb_result_field * result_add(struct nb_result * r, const char * key, const char * label)
+{
+    struct nb_result_field * f;
+    if (r->count == NB_RESULT_FIELDS)
+    {
+        return NULL;
+    }
+    f = &r->fields[r->count++];
+    snprintf(f->key, sizeof(f->key), "%s", key);
+    snprintf(f->label, sizeof(f->label), "%s", label);
+    f->value[0] = '\0';
+    f->string = 0;
+    f->null = 0;
+    return f;
+}
+
+void nb_result_str(struct nb_result * r, const char * key, const char * label, const char * value)
+{
+    struct nb_result_field * f = result_add(r, key, label);
+    if (f)
+    {
+        snprintf(f->value, sizeof(f->value), "%s", value);
+        f->string = 1;
+    }
+}
+
+void nb_result_int(struct nb_result * r, const char * key, const char * label, int64_t value)
+{
+    struct nb_result_field * f = result_add(r, key, label);
+    if (f)
+    {
+        snprintf(f->value, sizeof(f->value), "%" PRId64, value);
+    }
+}
+
+void nb_result_double(struct nb_result * r, const char * key, const char * label, double value, int precision)
+{
+    struct nb_result_field * f = result_add(r, key, label);
+    if (f)
+    {
+        if (isfinite(value))
+        {
+            snprintf(f->value, sizeof(f->value), "%.*f", precision, value);
+        }
+        else
+        {
+            f->null = 1;
+        }
+    }
+}
+
+void nb_result_metrics(
+    struct nb_result * r, uint64_t elapsed_ns, const struct nb_counters * counters, const struct nb_histogram * latency)
+{
+    double elapsed = (double)elapsed_ns / 1e9;
+    double messages = (double)counters->messages;
+
+    nb_result_int(r, "clients", "Clients", (int64_t)counters->sessions);
+    nb_result_int(r, "errors", "Errors", (int64_t)counters->errors);
+    nb_result_double(r, "elapsed_s", "Elapsed: s", elapsed, 3);
+    nb_result_double(r, "avg_msg_size", "Avg messages size", (double)counters->bytes_read / messages, 3);
+    nb_result_double(r, "mib_s", "Throughtput: MiB/s", (double)counters->bytes_read / (elapsed * 1024 * 1024), 3);
+    nb_result_double(r, "msg_s", "Msg/s", messages / elapsed, 0);
+    nb_result_double(r, "us_per_msg", "us/msg", 1e6 * elapsed / messages, 3);
+    nb_result_double(r, "p50_us", "p50 us", (double)nb_histogram_percentile(latency, 50.0) / 1000, 3);
+    nb_result_double(r, "p90_us", "p90 us", (double)nb_histogram_percentile(latency, 90.0) / 1000, 3);
+    nb_result_double(r, "p99_us", "p99 us", (double)nb_histogram_percentile(latency, 99.0) / 1000, 3);
+    nb_result_double(r, "p999_us", "p99.9 us", (double)nb_histogram_percentile(latency, 99.9) / 1000, 3);
+    nb_result_double(r, "max_us", "max us", (double)nb_histogram_percentile(latency, 100.0) / 1000, 3);
+    nb_result_double(r, "verify_ns_per_msg", "Verify: ns/msg", (double)counters->verify_ns / messages, 3);
+    nb_result_int(r, "corrupted", "Corrupted", (int64_t)counters->corrupted);
+    nb_result_int(r, "bytes_read", "Total read: bytes", (int64_t)counters->bytes_read);
+    nb_result_int(r, "messages", "messages", (int64_t)counters->messages);
+}
+
+/* Key and label of role field: "client_" + name, "Client " + label_name, no prefix for NULL role */
+static void role_field(char * key, char * label, const char * role, const char * name, const char * label_name)
+{
+    snprintf(key, NB_RESULT_KEY, "%s%s%s", role ? role : "", role ? "_" : "", name);
+    snprintf(label, NB_RESULT_KEY, "%s%s%s", role ? role : "", role ? " " : "", label_name);
+    if (label[0] >= 'a' && label[0] <= 'z')
+    {
+        label[0] = (char)(label[0] - 'a' + 'A');
+    }
+}
+
+void nb_result_perf(
+    struct nb_result * r, const char * role, const struct nb_perf * p, const struct nb_perf_values * v, double units, const char * unit)
+{
+    static const char * const names[NB_PERF_COUNTERS] = {"cycles", "instructions", "cache_misses", "branch_misses", "cs", "syscalls"};
+    static const char * const labels[NB_PERF_COUNTERS] = {"cycles", "instructions", "cache misses", "branch misses", "cs", "syscalls"};
+    char name[NB_RESULT_KEY];
+    char label_name[NB_RESULT_KEY];
+    char key[NB_RESULT_KEY];
+    char label[NB_RESULT_KEY];
+    int i;
+
+    role_field(key, label, role, "perf", "perf");
+    nb_result_str(r, key, label, nb_perf_scope(p));
+    for (i = 0; i < NB_PERF_COUNTERS; ++i)
+    {
+        snprintf(name, sizeof(name), "%s_per_%s", names[i], unit);
+        snprintf(label_name, sizeof(label_name), "%s/%s", labels[i], unit);
+        role_field(key, label, role, name, label_name);
+        nb_result_double(r, key, label, v->valid[i] ? (double)v->values[i] / units : NAN, 3);
+    }
+    role_field(key, label, role, "ipc", "IPC");
+    nb_result_double(
+        r,
+        key,
+        label,
+        v->valid[NB_PERF_CYCLES] && v->valid[NB_PERF_INSTRUCTIONS]
+            ? (double)v->values[NB_PERF_INSTRUCTIONS] / (double)v->values[NB_PERF_CYCLES]
+            : NAN,
+        3);
+}
+
+void nb_result_cputime(struct nb_result * r, const char * role, const struct nb_cputime_values * v, uint64_t elapsed_ns, double messages)
+{
+    char key[NB_RESULT_KEY];
+    char label[NB_RESULT_KEY];
+
+    role_field(key, label, role, "cpu_us_per_msg", "CPU us/msg");
+    nb_result_double(r, key, label, (double)v->cpu_ns / 1000 / messages, 3);
+    role_field(key, label, role, "user_us_per_msg", "user us/msg");
+    nb_result_double(r, key, label, (double)v->user_ns / 1000 / messages, 3);
+    role_field(key, label, role, "sys_us_per_msg", "sys us/msg");
+    nb_result_double(r, key, label, (double)v->sys_ns / 1000 / messages, 3);
+    role_field(key, label, role, "msg_per_cpu_s", "msg/CPU s");
+    nb_result_double(r, key, label, messages * 1e9 / (double)v->cpu_ns, 0);
+    role_field(key, label, role, "cpu_cores", "CPU cores");
+    nb_result_double(r, key, label, (double)v->cpu_ns / (double)elapsed_ns, 3);
+    role_field(key, label, role, "vcs_per_msg", "voluntary cs/msg");
+    nb_result_double(r, key, label, (double)v->voluntary_cs / messages, 3);
+    role_field(key, label, role, "ivcs_per_msg", "involuntary cs/msg");
+    nb_result_double(r, key, label, (double)v->involuntary_cs / messages, 3);
+}
+
+/* Column width fits label and value */
+static int field_width(const struct nb_result_field * f)
+{
+    size_t label = strlen(f->label);
+    size_t value = f->null ? 1 : strlen(f->value);
+    return (int)(label > value ? label : value);
+}
+
+static void print_table(FILE * out, const struct nb_result * r, int header)
+{
+    size_t i;
+    if (header)
+    {
+        for (i = 0; i < r->count; ++i)
+        {
+            fprintf(out, "%s%*s", i ? " " : "", field_width(&r->fields[i]), r->fields[i].label);
+        }
+        fputc('\n', out);
+    }
+    for (i = 0; i < r->count; ++i)
+    {
+        const struct nb_result_field * f = &r->fields[i];
+        fprintf(out, "%s%*s", i ? " " : "", field_width(f), f->null ? "-" : f->value);
+    }
+    fputc('\n', out);
+}
+
+static void print_csv_value(FILE * out, const char * value)
+{
+    const char * p;
+    if (strpbrk(value, ",\"\r\n") == NULL)
+    {
+        fputs(value, out);
+        return;
+    }
+    fputc('"', out);
+    for (p = value; *p; ++p)
+    {
+        if (*p == '"')
+        {
+            fputc('"', out);
+        }
+        fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+/* Output appended to non-empty file already has the header */
+static int csv_appending(FILE * out)
+{
+    struct stat st;
+    fflush(out);
+    return fstat(fileno(out), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+}
+
+static void print_csv(FILE * out, const struct nb_result * r, int header)
+{
+    size_t i;
+    if (header && !csv_appending(out))
+    {
+        for (i = 0; i < r->count; ++i)
+        {
+            fprintf(out, "%s%s", i ? "," : "", r->fields[i].key);
+        }
+        fputc('\n', out);
+    }
+    for (i = 0; i < r->count; ++i)
+    {
+        if (i)
+        {
+            fputc(',', out);
+        }
+        if (!r->fields[i].null)
+        {
+            print_csv_value(out, r->fields[i].value);
+        }
+    }
+    fputc('\n', out);
+}
+
+static void print_json_string(FILE * out, const char * value)
+{
+    const unsigned char * p;
+    fputc('"', out);
+    for (p = (const unsigned char *)value; *p; ++p)
+    {
+        if (*p == '"' || *p == '\\')
+        {
+            fprintf(out, "\\%c", *p);
+        }
+        else if (*p < 0x20)
+        {
+            fprintf(out, "\\u%04x", *p);
+        }
+        else
+        {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void print_json(FILE * out, const struct nb_result * r)
+{
+    size_t i;
+    fputc('{', out);
+    for (i = 0; i < r->count; ++i)
+    {
+        const struct nb_result_field * f = &r->fields[i];
+        if (i)
+        {
+            fputs(", ", out);
+        }
+        print_json_string(out, f->key);
+        fputs(": ", out);
+        if (f->null)
+        {
+            fputs("null", out);
+        }
+        else if (f->string)
+        {
+            print_json_string(out, f->value);
+        }
+        else
+        {
+            fputs(f->value, out);
+        }
+    }
+    fputs("}\n", out);
+}
+
+void nb_result_print(FILE * out, enum nb_format format, const struct nb_result * r, int header)
+{
+    switch (format)
+    {
+        case NB_FORMAT_TABLE:
+            print_table(out, r, header);
+            break;
+        case NB_FORMAT_CSV:
+            print_csv(out, r, header);
+            break;
+        case NB_FORMAT_JSON:
+            print_json(out, r);
+            break;
+    }
+    fflush(out);
+}
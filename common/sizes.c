@@ -0,0 +1,209 @@
+/*
+ * Message size distribution
+ */
+#include <netbench/sizes.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FILE_BINS 4096
+
+/* Deterministic generator for table fill, same spec gives same table */
+static double fill_random(uint64_t * state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return (double)(x >> 11) / (double)(1ULL << 53);
+}
+
+static void fill_uniform(uint32_t * table, size_t min, size_t max)
+{
+    size_t i;
+    uint64_t state = nb_sizes_seed(1);
+    for (i = 0; i < NB_SIZES_TABLE; ++i)
+    {
+        table[i] = (uint32_t)(min + (size_t)(fill_random(&state) * (double)(max - min + 1)));
+        if (table[i] > max)
+        {
+            table[i] = (uint32_t)max;
+        }
+    }
+}
+
+static void fill_lognormal(uint32_t * table, double median, double sigma, size_t max)
+{
+    size_t i;
+    uint64_t state = nb_sizes_seed(1);
+    double mu = log(median);
+    for (i = 0; i < NB_SIZES_TABLE; ++i)
+    {
+        /* Box-Muller */
+        double u1 = fill_random(&state);
+        double u2 = fill_random(&state);
+        double z = sqrt(-2.0 * log(u1 > 0 ? u1 : 1e-300)) * cos(2 * M_PI * u2);
+        double v = exp(mu + sigma * z);
+        if (v < 1)
+        {
+            v = 1;
+        }
+        else if (v > (double)max)
+        {
+            v = (double)max;
+        }
+        table[i] = (uint32_t)v;
+    }
+}
+
+/* Table entries in proportion to weights, rest of rounding goes to last bin */
+static void fill_weighted(uint32_t * table, const size_t * sizes, const double * weights, size_t n)
+{
+    size_t i, pos = 0;
+    double total = 0, cumulative = 0;
+    for (i = 0; i < n; ++i)
+    {
+        total += weights[i];
+    }
+    for (i = 0; i < n; ++i)
+    {
+        size_t end;
+        cumulative += weights[i];
+        end = (size_t)(cumulative / total * NB_SIZES_TABLE + 0.5);
+        while (pos < end && pos < NB_SIZES_TABLE)
+        {
+            table[pos++] = (uint32_t)sizes[i];
+        }
+    }
+    while (pos < NB_SIZES_TABLE)
+    {
+        table[pos++] = (uint32_t)sizes[n - 1];
+    }
+}
+
+static int load_file(uint32_t * table, const char * path)
+{
+    static size_t sizes[MAX_FILE_BINS];
+    static double weights[MAX_FILE_BINS];
+    size_t n = 0;
+    double total = 0;
+    char line[256];
+    FILE * f = fopen(path, "r");
+    if (f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        unsigned long size;
+        double weight;
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        if (sscanf(line, "%lu %lf", &size, &weight) != 2 || size == 0 || size > UINT32_MAX || weight < 0)
+        {
+            fprintf(stderr, "%s: invalid line: %s", path, line);
+            fclose(f);
+            return -1;
+        }
+        if (n == MAX_FILE_BINS)
+        {
+            fprintf(stderr, "%s: more than %d sizes\n", path, MAX_FILE_BINS);
+            fclose(f);
+            return -1;
+        }
+        sizes[n] = size;
+        weights[n] = weight;
+        total += weight;
+        ++n;
+    }
+    fclose(f);
+    if (n == 0 || total <= 0)
+    {
+        fprintf(stderr, "%s: no sizes\n", path);
+        return -1;
+    }
+    fill_weighted(table, sizes, weights, n);
+    return 0;
+}
+
+static int parse_spec(uint32_t * table, const char * spec)
+{
+    unsigned long a, b;
+    double median, sigma, percent;
+    char tail;
+
+    if (sscanf(spec, "fixed:%lu%c", &a, &tail) == 1 && a > 0)
+    {
+        fill_uniform(table, a, a);
+    }
+    else if (sscanf(spec, "uniform:%lu:%lu%c", &a, &b, &tail) == 2 && a > 0 && b >= a)
+    {
+        fill_uniform(table, a, b);
+    }
+    else if (sscanf(spec, "lognormal:%lf:%lf:%lu%c", &median, &sigma, &b, &tail) == 3 && median >= 1 && sigma >= 0 && b > 0)
+    {
+        fill_lognormal(table, median, sigma, b);
+    }
+    else if (sscanf(spec, "bimodal:%lu:%lu:%lf%c", &a, &b, &percent, &tail) == 3 && a > 0 && b > 0 && percent >= 0 && percent <= 100)
+    {
+        size_t sizes[2] = {a, b};
+        double weights[2] = {100 - percent, percent};
+        fill_weighted(table, sizes, weights, 2);
+    }
+    else if (strncmp(spec, "file:", 5) == 0)
+    {
+        return load_file(table, spec + 5);
+    }
+    else
+    {
+        fprintf(stderr, "Invalid size distribution \"%s\"\n", spec);
+        return -1;
+    }
+    return 0;
+}
+
+int nb_sizes_parse(struct nb_sizes * d, const char * spec)
+{
+    size_t i;
+    double sum = 0;
+
+    d->table = malloc(NB_SIZES_TABLE * sizeof(uint32_t));
+    if (d->table == NULL)
+    {
+        return -1;
+    }
+    if (parse_spec(d->table, spec) == -1)
+    {
+        nb_sizes_free(d);
+        return -1;
+    }
+
+    d->min = d->table[0];
+    d->max = d->table[0];
+    for (i = 0; i < NB_SIZES_TABLE; ++i)
+    {
+        if (d->table[i] < d->min)
+        {
+            d->min = d->table[i];
+        }
+        if (d->table[i] > d->max)
+        {
+            d->max = d->table[i];
+        }
+        sum += d->table[i];
+    }
+    d->mean = sum / NB_SIZES_TABLE;
+    return 0;
+}
+
+void nb_sizes_free(struct nb_sizes * d)
+{
+    free(d->table);
+    d->table = NULL;
+}
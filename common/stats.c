@@ -0,0 +1,151 @@
+/*
+ * Contention-free per-thread statistics
+ */
+#include <netbench/stats.h>
+
+#include <netbench/clock.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+int nb_stats_init(struct nb_stats * s, size_t slot_count)
+{
+    size_t i;
+    s->slot_count = slot_count;
+    s->slots = aligned_alloc(NB_CACHE_LINE, slot_count * sizeof(struct nb_stats_slot));
+    if (s->slots == NULL)
+    {
+        s->slot_count = 0;
+        return -1;
+    }
+    for (i = 0; i < slot_count; ++i)
+    {
+        memset(&s->slots[i].counters, 0, sizeof(s->slots[i].counters));
+        nb_histogram_init(&s->slots[i].latency);
+    }
+    return 0;
+}
+
+void nb_stats_free(struct nb_stats * s)
+{
+    free(s->slots);
+    s->slots = NULL;
+    s->slot_count = 0;
+}
+
+static void counters_merge(struct nb_counters * dst, const struct nb_counters * src)
+{
+    dst->bytes_written += nb_counter_load(&src->bytes_written);
+    dst->bytes_read += nb_counter_load(&src->bytes_read);
+    dst->writes += nb_counter_load(&src->writes);
+    dst->reads += nb_counter_load(&src->reads);
+    dst->messages += nb_counter_load(&src->messages);
+    dst->sessions += nb_counter_load(&src->sessions);
+    dst->errors += nb_counter_load(&src->errors);
+    dst->allocations += nb_counter_load(&src->allocations);
+    dst->verify_ns += nb_counter_load(&src->verify_ns);
+    dst->corrupted += nb_counter_load(&src->corrupted);
+}
+
+static void histogram_merge(struct nb_histogram * dst, const struct nb_histogram * src)
+{
+    size_t i;
+    uint64_t v;
+    if (nb_counter_load(&src->count) == 0)
+    {
+        return;
+    }
+    for (i = 0; i < NB_HISTOGRAM_BUCKETS; ++i)
+    {
+        dst->counts[i] += nb_counter_load(&src->counts[i]);
+    }
+    dst->count += nb_counter_load(&src->count);
+    dst->sum += nb_counter_load(&src->sum);
+    v = nb_counter_load(&src->min);
+    if (v < dst->min)
+    {
+        dst->min = v;
+    }
+    v = nb_counter_load(&src->max);
+    if (v > dst->max)
+    {
+        dst->max = v;
+    }
+}
+
+void nb_stats_snapshot(const struct nb_stats * s, struct nb_counters * counters, struct nb_histogram * latency)
+{
+    size_t i;
+    memset(counters, 0, sizeof(*counters));
+    if (latency)
+    {
+        nb_histogram_init(latency);
+    }
+    for (i = 0; i < s->slot_count; ++i)
+    {
+        counters_merge(counters, &s->slots[i].counters);
+        if (latency)
+        {
+            histogram_merge(latency, &s->slots[i].latency);
+        }
+    }
+}
+
+void nb_stats_window_start(struct nb_stats_window * w, const struct nb_stats * s)
+{
+    w->start_ns = nb_time_ns();
+    nb_stats_snapshot(s, &w->counters, &w->latency);
+}
+
+static void counters_diff(struct nb_counters * dst, const struct nb_counters * cur, const struct nb_counters * prev)
+{
+    dst->bytes_written = cur->bytes_written - prev->bytes_written;
+    dst->bytes_read = cur->bytes_read - prev->bytes_read;
+    dst->writes = cur->writes - prev->writes;
+    dst->reads = cur->reads - prev->reads;
+    dst->messages = cur->messages - prev->messages;
+    dst->sessions = cur->sessions;
+    dst->errors = cur->errors;
+    dst->allocations = cur->allocations - prev->allocations;
+    dst->verify_ns = cur->verify_ns - prev->verify_ns;
+    dst->corrupted = cur->corrupted - prev->corrupted;
+}
+
+/* Snapshot into cur, diff against window baseline */
+static uint64_t window_diff(
+    const struct nb_stats_window * w,
+    const struct nb_stats * s,
+    struct nb_counters * cur,
+    struct nb_histogram * cur_latency,
+    struct nb_counters * counters,
+    struct nb_histogram * latency)
+{
+    uint64_t now = nb_time_ns();
+    nb_stats_snapshot(s, cur, cur_latency);
+    counters_diff(counters, cur, &w->counters);
+    if (latency)
+    {
+        nb_histogram_diff(latency, cur_latency, &w->latency);
+    }
+    return now;
+}
+
+uint64_t nb_stats_window_get(const struct nb_stats_window * w, const struct nb_stats * s, struct nb_counters * counters, struct nb_histogram * latency)
+{
+    struct nb_counters cur;
+    struct nb_histogram cur_latency;
+    return window_diff(w, s, &cur, &cur_latency, counters, latency) - w->start_ns;
+}
+
+uint64_t nb_stats_window_next(struct nb_stats_window * w, const struct nb_stats * s, struct nb_counters * counters, struct nb_histogram * latency)
+{
+    struct nb_counters cur;
+    struct nb_histogram cur_latency;
+    uint64_t now = window_diff(w, s, &cur, &cur_latency, counters, latency);
+    uint64_t elapsed = now - w->start_ns;
+
+    w->start_ns = now;
+    w->counters = cur;
+    w->latency = cur_latency;
+    return elapsed;
+}
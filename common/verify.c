@@ -0,0 +1,96 @@
+/*
+ * Echo payload verification
+ */
+#include <netbench/verify.h>
+
+#include <string.h>
+
+#define SEQ_SIZE 8
+#define CRC_SIZE 4
+
+void nb_verify_init(struct nb_verify * v)
+{
+    v->send_seq = 0;
+    v->recv_seq = 0;
+    v->crc = NB_CRC32C_INIT;
+    memset(v->trailer, 0, sizeof(v->trailer));
+}
+
+static void put_le(unsigned char * p, uint64_t value, size_t size)
+{
+    size_t i;
+    for (i = 0; i < size; ++i)
+    {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint64_t get_le(const unsigned char * p, size_t size)
+{
+    size_t i;
+    uint64_t value = 0;
+    for (i = 0; i < size; ++i)
+    {
+        value |= (uint64_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+void nb_verify_trailer(struct nb_verify * v, uint32_t crc, char * trailer)
+{
+    unsigned char * p = (unsigned char *)trailer;
+    put_le(p, v->send_seq++, SEQ_SIZE);
+    crc = nb_crc32c_update(crc, p, SEQ_SIZE);
+    put_le(p + SEQ_SIZE, ~crc, CRC_SIZE);
+}
+
+size_t nb_verify_check(struct nb_verify * v, const struct nb_inflight * q, const char * data, size_t size)
+{
+    size_t corrupted = 0;
+    size_t idx = q->head;
+    size_t pending = q->count;
+    size_t offset = q->received; /* in head message */
+
+    while (size > 0 && pending > 0)
+    {
+        size_t msg_size = q->msgs[idx].size;
+        size_t crc_end = msg_size - CRC_SIZE;
+        size_t trailer_begin = msg_size - NB_VERIFY_TRAILER;
+        size_t n = msg_size - offset;
+        size_t lo;
+        if (n > size)
+        {
+            n = size;
+        }
+
+        if (offset < crc_end)
+        {
+            v->crc = nb_crc32c_update(v->crc, data, (offset + n < crc_end ? offset + n : crc_end) - offset);
+        }
+        lo = offset > trailer_begin ? offset : trailer_begin;
+        if (lo < offset + n)
+        {
+            memcpy(v->trailer + (lo - trailer_begin), data + (lo - offset), offset + n - lo);
+        }
+
+        data += n;
+        size -= n;
+        offset += n;
+        if (offset == msg_size)
+        {
+            if (get_le(v->trailer, SEQ_SIZE) != v->recv_seq || (uint32_t)get_le(v->trailer + SEQ_SIZE, CRC_SIZE) != (uint32_t)~v->crc)
+            {
+                ++corrupted;
+            }
+            ++v->recv_seq;
+            v->crc = NB_CRC32C_INIT;
+            offset = 0;
+            if (++idx == q->capacity)
+            {
+                idx = 0;
+            }
+            --pending;
+        }
+    }
+    return corrupted;
+}
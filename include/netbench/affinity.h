@@ -0,0 +1,48 @@
+#ifndef _NETBENCH_AFFINITY_H
+#define _NETBENCH_AFFINITY_H
+
+/*
+ * CPU affinity and NUMA placement of event loop threads.
+ *
+ * CPU list format is like taskset -c: "0-3,8,10-11". Threads get CPUs round-robin by thread index.
+ * Placed thread prefers memory of CPU's NUMA node, so buffers and sessions allocated (first touched)
+ * by the thread after placement are node local.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct nb_cpus
+{
+    int * cpus;
+    size_t count; /* 0 - not pinned */
+};
+
+/* Return 0 on success, -1 on invalid list or CPU not allowed for process (error is printed to stderr) */
+int nb_cpus_parse(struct nb_cpus * c, const char * list);
+
+void nb_cpus_free(struct nb_cpus * c);
+
+/* CPU for thread, -1 if list is empty */
+static inline int nb_cpus_get(const struct nb_cpus * c, size_t thread_idx)
+{
+    return c->count ? c->cpus[thread_idx % c->count] : -1;
+}
+
+/* NUMA node of CPU, -1 if unknown */
+int nb_cpu_node(int cpu);
+
+/* Pin calling thread to CPU and prefer memory of its NUMA node, nothing for CPU -1. Return 0 on success, -1 on error */
+int nb_thread_place(int cpu);
+
+/* Sorted NUMA nodes of first threads CPUs ("0", "0,1"), "-" for empty list */
+void nb_cpus_nodes(const struct nb_cpus * c, size_t threads, char * buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_AFFINITY_H */
@@ -0,0 +1,65 @@
+#ifndef _NETBENCH_CPUTIME_H
+#define _NETBENCH_CPUTIME_H
+
+/*
+ * CPU time and context switches of event loop threads.
+ *
+ * Like perf counters group: each thread registers itself with nb_cputime_attach, any thread reads sums
+ * of all registered threads, measurement window is a difference of two reads. Total CPU time is the precise
+ * thread CPU clock, user/sys split and context switches are from /proc/self/task/<tid> (clock tick resolution).
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct nb_cputime_values
+{
+    uint64_t cpu_ns;
+    uint64_t user_ns;
+    uint64_t sys_ns;
+    uint64_t voluntary_cs; /* blocked in epoll_wait, mutex, ... */
+    uint64_t involuntary_cs; /* preempted */
+};
+
+struct nb_cputime_thread
+{
+    pid_t tid;
+    clockid_t clock;
+};
+
+struct nb_cputime
+{
+    pthread_mutex_t lock;
+    struct nb_cputime_thread * threads;
+    size_t count;
+    size_t capacity;
+};
+
+/* Return 0 on success, -1 on error */
+int nb_cputime_init(struct nb_cputime * t);
+
+void nb_cputime_free(struct nb_cputime * t);
+
+/* Register calling thread, it must be running while group is read */
+void nb_cputime_attach(struct nb_cputime * t);
+
+void nb_cputime_read(struct nb_cputime * t, struct nb_cputime_values * v);
+
+/* User and sys time of all threads of another process (cpu_ns is their sum, no context switches). Return 0 on success, -1 on error */
+int nb_cputime_read_process(pid_t pid, struct nb_cputime_values * v);
+
+/* dst = cur - prev */
+void nb_cputime_diff(struct nb_cputime_values * dst, const struct nb_cputime_values * cur, const struct nb_cputime_values * prev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_CPUTIME_H */
@@ -0,0 +1,29 @@
+#ifndef _NETBENCH_CRC32C_H
+#define _NETBENCH_CRC32C_H
+
+/*
+ * CRC32C (Castagnoli), SSE4.2 crc32 instruction if CPU supports it (selected at runtime), table driven otherwise.
+ *
+ * NB_CRC32C=scalar environment variable forces table driven implementation.
+ * Running state starts with NB_CRC32C_INIT, checksum is ~state.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NB_CRC32C_INIT 0xFFFFFFFFU
+
+uint32_t nb_crc32c_update(uint32_t state, const void * data, size_t size);
+
+/* Implementation in use: "sse4.2" or "scalar" */
+const char * nb_crc32c_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_CRC32C_H */
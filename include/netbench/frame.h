@@ -0,0 +1,59 @@
+#ifndef _NETBENCH_FRAME_H
+#define _NETBENCH_FRAME_H
+
+/*
+ * Length-prefixed framing: 4 bytes payload size (network byte order), then payload.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NB_FRAME_HEADER_SIZE 4
+
+static inline void nb_frame_header_write(char * header, uint32_t payload_size)
+{
+    unsigned char * p = (unsigned char *)header;
+    p[0] = (unsigned char)(payload_size >> 24);
+    p[1] = (unsigned char)(payload_size >> 16);
+    p[2] = (unsigned char)(payload_size >> 8);
+    p[3] = (unsigned char)payload_size;
+}
+
+static inline uint32_t nb_frame_header_read(const char * header)
+{
+    const unsigned char * p = (const unsigned char *)header;
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/*
+ * Size of whole frames at start of data (0 if first frame is incomplete),
+ * or (size_t)-1 if frame payload is larger than max_payload.
+ */
+static inline size_t nb_frame_complete(const char * data, size_t size, size_t max_payload)
+{
+    size_t offset = 0;
+    while (size - offset >= NB_FRAME_HEADER_SIZE)
+    {
+        size_t payload_size = nb_frame_header_read(data + offset);
+        if (payload_size > max_payload)
+        {
+            return (size_t)-1;
+        }
+        if (size - offset < NB_FRAME_HEADER_SIZE + payload_size)
+        {
+            break;
+        }
+        offset += NB_FRAME_HEADER_SIZE + payload_size;
+    }
+    return offset;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_FRAME_H */
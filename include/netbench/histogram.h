@@ -0,0 +1,83 @@
+#ifndef _NETBENCH_HISTOGRAM_H
+#define _NETBENCH_HISTOGRAM_H
+
+/*
+ * Fixed memory log-linear (HDR-style) histogram.
+ *
+ * Values below NB_HISTOGRAM_SUB_COUNT are recorded exactly, larger values go into
+ * NB_HISTOGRAM_SUB_COUNT / 2 linear sub-buckets per power of two, so relative error is below 1/32.
+ * Values above 2^NB_HISTOGRAM_MAX_BITS - 1 (about 68.7 s in ns) are clamped into the last bucket,
+ * but exact maximum is tracked separately.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NB_HISTOGRAM_SUB_BITS 6
+#define NB_HISTOGRAM_MAX_BITS 36
+#define NB_HISTOGRAM_SUB_COUNT (1 << NB_HISTOGRAM_SUB_BITS)
+#define NB_HISTOGRAM_HALF_COUNT (NB_HISTOGRAM_SUB_COUNT / 2)
+#define NB_HISTOGRAM_BUCKETS (NB_HISTOGRAM_SUB_COUNT + (NB_HISTOGRAM_MAX_BITS - NB_HISTOGRAM_SUB_BITS) * NB_HISTOGRAM_HALF_COUNT)
+
+struct nb_histogram
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t counts[NB_HISTOGRAM_BUCKETS];
+};
+
+void nb_histogram_init(struct nb_histogram * h);
+
+static inline size_t nb_histogram_index(uint64_t value)
+{
+    unsigned shift;
+    if (value < NB_HISTOGRAM_SUB_COUNT)
+    {
+        return (size_t)value;
+    }
+    if (value >> NB_HISTOGRAM_MAX_BITS)
+    {
+        return NB_HISTOGRAM_BUCKETS - 1;
+    }
+    /* value in [2^(shift + SUB_BITS - 1), 2^(shift + SUB_BITS)), so (value >> shift) in [HALF_COUNT, SUB_COUNT) */
+    shift = (unsigned)(63 - __builtin_clzll(value)) - NB_HISTOGRAM_SUB_BITS + 1;
+    return NB_HISTOGRAM_SUB_COUNT + (shift - 1) * NB_HISTOGRAM_HALF_COUNT + (size_t)(value >> shift) - NB_HISTOGRAM_HALF_COUNT;
+}
+
+static inline void nb_histogram_record(struct nb_histogram * h, uint64_t value)
+{
+    h->counts[nb_histogram_index(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value < h->min)
+    {
+        h->min = value;
+    }
+    if (value > h->max)
+    {
+        h->max = value;
+    }
+}
+
+/* Add src counts to dst */
+void nb_histogram_merge(struct nb_histogram * dst, const struct nb_histogram * src);
+
+/* Values recorded to cur since prev (earlier copy of the same histogram), min and max are bucket bounds */
+void nb_histogram_diff(struct nb_histogram * dst, const struct nb_histogram * cur, const struct nb_histogram * prev);
+
+/* Highest value, equivalent to value at percentile (0.0 - 100.0), 0 for empty histogram */
+uint64_t nb_histogram_percentile(const struct nb_histogram * h, double percentile);
+
+double nb_histogram_mean(const struct nb_histogram * h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_HISTOGRAM_H */
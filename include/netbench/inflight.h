@@ -0,0 +1,101 @@
+#ifndef _NETBENCH_INFLIGHT_H
+#define _NETBENCH_INFLIGHT_H
+
+/*
+ * Per-session FIFO of messages in flight (pipelined request/response over one stream).
+ *
+ * Responses come back in order, but split or coalesced by reads, so received bytes are accumulated
+ * and a message is completed when all of it's bytes are echoed back.
+ * Not thread-safe, owned by session.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <netbench/stats.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct nb_inflight_msg
+{
+    uint64_t start_ns; /* latency is measured from this time */
+    size_t size;
+};
+
+struct nb_inflight
+{
+    struct nb_inflight_msg * msgs;
+    size_t capacity; /* max messages in flight */
+    size_t head;
+    size_t count;
+    size_t received; /* bytes received for head message */
+};
+
+/* Return 0 on success, -1 on allocation failure */
+int nb_inflight_init(struct nb_inflight * q, size_t capacity);
+
+void nb_inflight_free(struct nb_inflight * q);
+
+/* Free places for new messages */
+static inline size_t nb_inflight_space(const struct nb_inflight * q)
+{
+    return q->capacity - q->count;
+}
+
+/* Caller checks nb_inflight_space() before push */
+static inline void nb_inflight_push(struct nb_inflight * q, uint64_t start_ns, size_t size)
+{
+    size_t tail = q->head + q->count;
+    if (tail >= q->capacity)
+    {
+        tail -= q->capacity;
+    }
+    q->msgs[tail].start_ns = start_ns;
+    q->msgs[tail].size = size;
+    ++q->count;
+}
+
+/* Start last count pushed messages ns later: client work between push and send of the batch (verify stamping) is not latency */
+static inline void nb_inflight_delay(struct nb_inflight * q, size_t count, uint64_t ns)
+{
+    size_t i, idx;
+    for (i = q->count - count; i < q->count; ++i)
+    {
+        idx = q->head + i;
+        if (idx >= q->capacity)
+        {
+            idx -= q->capacity;
+        }
+        q->msgs[idx].start_ns += ns;
+    }
+}
+
+/*
+ * Account received bytes, record latency of each completed message in slot.
+ * Return count of completed messages.
+ */
+static inline size_t nb_inflight_ack(struct nb_inflight * q, size_t bytes, uint64_t now_ns, struct nb_stats_slot * slot)
+{
+    size_t completed = 0;
+    q->received += bytes;
+    while (q->count > 0 && q->received >= q->msgs[q->head].size)
+    {
+        q->received -= q->msgs[q->head].size;
+        nb_stats_message(slot, now_ns - q->msgs[q->head].start_ns);
+        if (++q->head == q->capacity)
+        {
+            q->head = 0;
+        }
+        --q->count;
+        ++completed;
+    }
+    return completed;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_INFLIGHT_H */
@@ -0,0 +1,69 @@
+#ifndef _NETBENCH_PERF_H
+#define _NETBENCH_PERF_H
+
+/*
+ * Hardware performance counters (perf_event_open) of event loop threads.
+ *
+ * Each thread opens own counters with nb_perf_attach, any thread can read sums of all attached threads,
+ * so measurement window is a difference of two reads. Kernel mode is counted if perf_event_paranoid allows,
+ * counters not supported by CPU or VM are reported as not valid. Syscalls are counted by raw_syscalls:sys_enter
+ * tracepoint, it needs tracefs and kernel mode access.
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum nb_perf_counter
+{
+    NB_PERF_CYCLES,
+    NB_PERF_INSTRUCTIONS,
+    NB_PERF_CACHE_MISSES,
+    NB_PERF_BRANCH_MISSES,
+    NB_PERF_CONTEXT_SWITCHES,
+    NB_PERF_SYSCALLS,
+    NB_PERF_COUNTERS
+};
+
+struct nb_perf_values
+{
+    uint64_t values[NB_PERF_COUNTERS]; /* scaled for counters multiplexing */
+    int valid[NB_PERF_COUNTERS]; /* opened in all attached threads */
+};
+
+struct nb_perf
+{
+    pthread_mutex_t lock;
+    int (*fds)[NB_PERF_COUNTERS]; /* per attached thread, -1 if not opened */
+    size_t count;
+    size_t capacity;
+    int enabled;
+    int kernel; /* kernel mode is counted */
+};
+
+/* Disabled group ignores attach and reads nothing valid. Return 0 on success, -1 on error */
+int nb_perf_init(struct nb_perf * p, int enabled);
+
+/* Close counters, call after attached threads are stopped */
+void nb_perf_free(struct nb_perf * p);
+
+/* Open counters of calling thread */
+void nb_perf_attach(struct nb_perf * p);
+
+void nb_perf_read(struct nb_perf * p, struct nb_perf_values * v);
+
+/* dst = cur - prev, valid in both */
+void nb_perf_diff(struct nb_perf_values * dst, const struct nb_perf_values * cur, const struct nb_perf_values * prev);
+
+/* "off", "none" (nothing opened), "user" or "user+kernel" */
+const char * nb_perf_scope(const struct nb_perf * p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_PERF_H */
@@ -0,0 +1,26 @@
+#ifndef _NETBENCH_READY_H
+#define _NETBENCH_READY_H
+
+/*
+ * Server readiness notification over a pipe.
+ *
+ * Server writes "ready" line when all its listeners are bound ("failed" otherwise) and closes the write end,
+ * client or launcher waits on the read end instead of sleeping. Works the same for a server thread in the
+ * client process and for a server process started with --ready-fd (inherited write end).
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Write "ready" or "failed" and close fd, nothing for fd -1 */
+void nb_ready_notify(int fd, int ok);
+
+/* Wait for notification and close fd. Return 0 if ready, -1 on failure, EOF (server exited) or timeout (error is printed to stderr) */
+int nb_ready_wait(int fd, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_READY_H */
@@ -0,0 +1,27 @@
+#ifndef _NETBENCH_REPORT_H
+#define _NETBENCH_REPORT_H
+
+/*
+ * Periodic interval report lines
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <netbench/stats.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void nb_report_interval_header(FILE * out);
+
+/* time_ns is since measurement start, elapsed_ns is interval length */
+void nb_report_interval(
+    FILE * out, uint64_t time_ns, uint64_t elapsed_ns, const struct nb_counters * counters, const struct nb_histogram * latency);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_REPORT_H */
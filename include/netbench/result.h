@@ -0,0 +1,81 @@
+#ifndef _NETBENCH_RESULT_H
+#define _NETBENCH_RESULT_H
+
+/*
+ * Benchmark result record and emitter.
+ *
+ * Record is an ordered list of fields: configuration first, then metrics. Each field has a key
+ * (snake_case, for csv header and json) and a label (for table header). Values are formatted when added.
+ *
+ * Formats:
+ *   table  human columns, header line before the row
+ *   csv    header line of keys before the row, skipped when appending to non-empty file
+ *   json   one object per line (JSON Lines), header is ignored
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <netbench/cputime.h>
+#include <netbench/histogram.h>
+#include <netbench/perf.h>
+#include <netbench/stats.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NB_RESULT_FIELDS 128
+#define NB_RESULT_KEY 48
+#define NB_RESULT_VALUE 128
+
+enum nb_format
+{
+    NB_FORMAT_TABLE,
+    NB_FORMAT_CSV,
+    NB_FORMAT_JSON
+};
+
+struct nb_result_field
+{
+    char key[NB_RESULT_KEY];
+    char label[NB_RESULT_KEY];
+    char value[NB_RESULT_VALUE];
+    int string; /* quoted in json */
+    int null; /* not a number (no messages), null in json, empty in csv */
+};
+
+struct nb_result
+{
+    size_t count;
+    struct nb_result_field fields[NB_RESULT_FIELDS];
+};
+
+/* Return 0 on success, -1 on unknown format name (error is printed to stderr) */
+int nb_format_parse(const char * name, enum nb_format * format);
+
+void nb_result_init(struct nb_result * r);
+
+/* Fields over NB_RESULT_FIELDS are dropped */
+void nb_result_str(struct nb_result * r, const char * key, const char * label, const char * value);
+void nb_result_int(struct nb_result * r, const char * key, const char * label, int64_t value);
+void nb_result_double(struct nb_result * r, const char * key, const char * label, double value, int precision);
+
+/* Ping-pong client metrics of measurement window */
+void nb_result_metrics(
+    struct nb_result * r, uint64_t elapsed_ns, const struct nb_counters * counters, const struct nb_histogram * latency);
+
+/* Hardware counters per unit ("msg", "event") of role threads ("client", "server", NULL - no key prefix), null if not counted */
+void nb_result_perf(
+    struct nb_result * r, const char * role, const struct nb_perf * p, const struct nb_perf_values * v, double units, const char * unit);
+
+/* CPU time per message, messages per CPU second and utilization (cores) of role threads over measurement window */
+void nb_result_cputime(struct nb_result * r, const char * role, const struct nb_cputime_values * v, uint64_t elapsed_ns, double messages);
+
+void nb_result_print(FILE * out, enum nb_format format, const struct nb_result * r, int header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_RESULT_H */
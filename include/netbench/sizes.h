@@ -0,0 +1,60 @@
+#ifndef _NETBENCH_SIZES_H
+#define _NETBENCH_SIZES_H
+
+/*
+ * Message size distribution.
+ *
+ * Distribution is sampled once into a table of NB_SIZES_TABLE sizes, so drawing a size on hot path
+ * is a xorshift step and a table load. Table is read-only after parse and may be shared by threads.
+ *
+ * Spec formats:
+ *   fixed:SIZE
+ *   uniform:MIN:MAX
+ *   lognormal:MEDIAN:SIGMA:MAX   (clamped to [1, MAX])
+ *   bimodal:SMALL:LARGE:PERCENT  (PERCENT of messages are LARGE)
+ *   file:PATH                    (empirical histogram, lines of "SIZE WEIGHT", # for comments)
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NB_SIZES_TABLE (1 << 16)
+
+struct nb_sizes
+{
+    uint32_t * table;
+    size_t min;
+    size_t max; /* buffers must be sized for max */
+    double mean;
+};
+
+/* Return 0 on success, -1 on invalid spec (error is printed to stderr) or allocation failure */
+int nb_sizes_parse(struct nb_sizes * d, const char * spec);
+
+void nb_sizes_free(struct nb_sizes * d);
+
+/* Per-session random state, must be non zero */
+static inline uint64_t nb_sizes_seed(uint64_t seed)
+{
+    return seed * 0x9E3779B97F4A7C15ULL | 1;
+}
+
+static inline size_t nb_sizes_next(const struct nb_sizes * d, uint64_t * state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return d->table[(x >> 32) & (NB_SIZES_TABLE - 1)];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_SIZES_H */
@@ -0,0 +1,149 @@
+#ifndef _NETBENCH_STATS_H
+#define _NETBENCH_STATS_H
+
+/*
+ * Contention-free statistics: one cache-line aligned slot per thread.
+ *
+ * Each slot is written only by its owner thread (relaxed atomic stores, no locks or RMW on hot path),
+ * slots are merged on report or snapshot, which is safe to do from any thread while counting is in progress.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <netbench/histogram.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NB_CACHE_LINE 64
+
+struct nb_counters
+{
+    uint64_t bytes_written;
+    uint64_t bytes_read;
+    uint64_t writes;
+    uint64_t reads;
+    uint64_t messages; /* completed request/response round trips */
+    uint64_t sessions;
+    uint64_t errors;
+    uint64_t allocations; /* heap allocations on I/O path */
+    uint64_t verify_ns; /* time spent in payload stamping and verification */
+    uint64_t corrupted; /* messages failed verification */
+};
+
+struct nb_stats_slot
+{
+    struct nb_counters counters;
+    struct nb_histogram latency; /* ns */
+} __attribute__((aligned(NB_CACHE_LINE)));
+
+struct nb_stats
+{
+    size_t slot_count;
+    struct nb_stats_slot * slots;
+};
+
+/* Return 0 on success, -1 on allocation failure */
+int nb_stats_init(struct nb_stats * s, size_t slot_count);
+
+void nb_stats_free(struct nb_stats * s);
+
+static inline struct nb_stats_slot * nb_stats_get_slot(struct nb_stats * s, size_t idx)
+{
+    return &s->slots[idx];
+}
+
+/* Single writer increment, readers can load counter concurrently */
+static inline void nb_counter_add(uint64_t * counter, uint64_t v)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + v, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t nb_counter_load(const uint64_t * counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static inline void nb_stats_read(struct nb_stats_slot * slot, uint64_t bytes)
+{
+    nb_counter_add(&slot->counters.bytes_read, bytes);
+    nb_counter_add(&slot->counters.reads, 1);
+}
+
+static inline void nb_stats_write(struct nb_stats_slot * slot, uint64_t bytes)
+{
+    nb_counter_add(&slot->counters.bytes_written, bytes);
+    nb_counter_add(&slot->counters.writes, 1);
+}
+
+static inline void nb_stats_session(struct nb_stats_slot * slot)
+{
+    nb_counter_add(&slot->counters.sessions, 1);
+}
+
+static inline void nb_stats_error(struct nb_stats_slot * slot)
+{
+    nb_counter_add(&slot->counters.errors, 1);
+}
+
+static inline void nb_stats_latency(struct nb_stats_slot * slot, uint64_t ns)
+{
+    struct nb_histogram * h = &slot->latency;
+    nb_counter_add(&h->counts[nb_histogram_index(ns)], 1);
+    nb_counter_add(&h->count, 1);
+    nb_counter_add(&h->sum, ns);
+    if (ns < h->min)
+    {
+        __atomic_store_n(&h->min, ns, __ATOMIC_RELAXED);
+    }
+    if (ns > h->max)
+    {
+        __atomic_store_n(&h->max, ns, __ATOMIC_RELAXED);
+    }
+}
+
+/* Message round trip completed */
+static inline void nb_stats_message(struct nb_stats_slot * slot, uint64_t latency_ns)
+{
+    nb_counter_add(&slot->counters.messages, 1);
+    nb_stats_latency(slot, latency_ns);
+}
+
+static inline void nb_stats_verify(struct nb_stats_slot * slot, uint64_t ns, uint64_t corrupted)
+{
+    nb_counter_add(&slot->counters.verify_ns, ns);
+    if (corrupted)
+    {
+        nb_counter_add(&slot->counters.corrupted, corrupted);
+    }
+}
+
+/* Merge all slots, latency can be NULL */
+void nb_stats_snapshot(const struct nb_stats * s, struct nb_counters * counters, struct nb_histogram * latency);
+
+/*
+ * Measurement window, stats since baseline snapshot (for warmup exclusion and interval reports).
+ * Sessions and errors are reported as totals, other counters as difference.
+ */
+struct nb_stats_window
+{
+    uint64_t start_ns;
+    struct nb_counters counters;
+    struct nb_histogram latency;
+};
+
+void nb_stats_window_start(struct nb_stats_window * w, const struct nb_stats * s);
+
+/* Stats since window start, return window length in ns */
+uint64_t nb_stats_window_get(const struct nb_stats_window * w, const struct nb_stats * s, struct nb_counters * counters, struct nb_histogram * latency);
+
+/* Same as nb_stats_window_get, then start next window from the same snapshot (no gaps between intervals) */
+uint64_t nb_stats_window_next(struct nb_stats_window * w, const struct nb_stats * s, struct nb_counters * counters, struct nb_histogram * latency);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_STATS_H */
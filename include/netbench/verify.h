@@ -0,0 +1,54 @@
+#ifndef _NETBENCH_VERIFY_H
+#define _NETBENCH_VERIFY_H
+
+/*
+ * Echo payload verification.
+ *
+ * Each message ends with trailer: sequence number (8 bytes) and CRC32C (4 bytes) of all message bytes before CRC,
+ * both little-endian. Echoed stream is checked incrementally (messages can be split by reads)
+ * against sizes of messages in flight.
+ * Not thread-safe, owned by session.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <netbench/crc32c.h>
+#include <netbench/inflight.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NB_VERIFY_TRAILER 12
+
+struct nb_verify
+{
+    uint64_t send_seq;
+    uint64_t recv_seq;
+    uint32_t crc; /* running state of message being received */
+    unsigned char trailer[NB_VERIFY_TRAILER]; /* trailer of message being received */
+};
+
+void nb_verify_init(struct nb_verify * v);
+
+/* Write trailer of next message, crc is running state of message bytes before trailer */
+void nb_verify_trailer(struct nb_verify * v, uint32_t crc, char * trailer);
+
+/* Stamp message in contiguous buffer, size >= NB_VERIFY_TRAILER */
+static inline void nb_verify_stamp(struct nb_verify * v, char * msg, size_t size)
+{
+    nb_verify_trailer(v, nb_crc32c_update(NB_CRC32C_INIT, msg, size - NB_VERIFY_TRAILER), msg + size - NB_VERIFY_TRAILER);
+}
+
+/*
+ * Check received bytes against messages in flight, must be called before nb_inflight_ack for the same bytes.
+ * Return count of corrupted (bad checksum or out of sequence) messages.
+ */
+size_t nb_verify_check(struct nb_verify * v, const struct nb_inflight * q, const char * data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETBENCH_VERIFY_H */
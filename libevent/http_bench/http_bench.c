@@ -48,11 +48,34 @@
 #include "event2/http.h"
 #include "event2/thread.h"
 
+#include <netbench/clock.h>
+#include <netbench/result.h>
+
 static void http_basic_cb(struct evhttp_request *req, void *arg);
 
 static char *content;
 static size_t content_len = 0;
 
+/* served requests, elapsed is from first to last request */
+static ev_uint64_t requests;
+static ev_uint64_t first_ns, last_ns;
+
+static void
+request_done(void)
+{
+	last_ns = nb_time_ns();
+	if (requests++ == 0)
+		first_ns = last_ns;
+}
+
+static void
+stop_cb(evutil_socket_t sig, short events, void *arg)
+{
+	struct event_base *base = arg;
+
+	event_base_loopexit(base, NULL);
+}
+
 static void
 http_basic_cb(struct evhttp_request *req, void *arg)
 {
@@ -64,6 +87,7 @@ http_basic_cb(struct evhttp_request *req, void *arg)
 	evhttp_send_reply(req, HTTP_OK, "Everything is fine", evb);
 
 	evbuffer_free(evb);
+	request_done();
 }
 
 #if LIBEVENT_VERSION_NUMBER >= 0x02000200
@@ -78,6 +102,7 @@ http_ref_cb(struct evhttp_request *req, void *arg)
 	evhttp_send_reply(req, HTTP_OK, "Everything is fine", evb);
 
 	evbuffer_free(evb);
+	request_done();
 }
 #endif
 
@@ -92,6 +117,10 @@ main(int argc, char **argv)
 	int use_iocp = 0;
 	ev_uint16_t port = 8080;
 	char *endptr = NULL;
+	enum nb_format format = NB_FORMAT_TABLE;
+	struct event *stop_ev;
+	struct nb_result result;
+	double elapsed;
 
 #ifdef _WIN32
 	WSADATA WSAData;
@@ -107,6 +136,12 @@ main(int argc, char **argv)
 
 		c = argv[i][1];
 
+		if (strncmp(argv[i], "--format=", 9) == 0) {
+			if (nb_format_parse(argv[i] + 9, &format) == -1)
+				exit(1);
+			continue;
+		}
+
 		if ((c == 'p' || c == 'l') && i + 1 >= argc) {
 			fprintf(stderr, "-%c requires argument.\n", c);
 			exit(1);
@@ -186,12 +221,32 @@ main(int argc, char **argv)
 		event_base_loopexit(base, &tv);
 	}
 #endif
+	/* result is printed on SIGINT */
+	stop_ev = evsignal_new(base, SIGINT, stop_cb, base);
+	event_add(stop_ev, NULL);
+
 	event_base_dispatch(base);
 
+	elapsed = (double)(last_ns - first_ns) / 1e9;
+	nb_result_init(&result);
+	nb_result_str(&result, "engine", "Engine", "http_bench");
+	nb_result_str(&result, "backend", "Backend", use_iocp ? "IOCP" : event_base_get_method(base));
+	nb_result_int(&result, "port", "Port", port);
+	nb_result_int(&result, "content_length", "Content length", (ev_int64_t)content_len);
+	nb_result_int(&result, "requests", "Requests", (ev_int64_t)requests);
+	nb_result_double(&result, "elapsed_s", "Elapsed: s", elapsed, 3);
+	nb_result_double(&result, "req_s", "Req/s", (double)requests / elapsed, 0);
+	nb_result_double(&result, "mib_s", "Throughtput: MiB/s", (double)(requests * content_len) / (elapsed * 1024 * 1024), 3);
+	nb_result_print(stdout, format, &result, 1);
+
+	event_free(stop_ev);
+	evhttp_free(http);
+	event_base_free(base);
+	free(content);
+
 #ifdef _WIN32
 	WSACleanup();
 #endif
 
-	/* NOTREACHED */
 	return (0);
 }
@@ -62,10 +62,17 @@
 #include <event.h>
 #include <evutil.h>
 
+#include <netbench/perf.h>
+#include <netbench/result.h>
+
+#define RUNS 25
+
 static int count, writes, fired, failures;
 static evutil_socket_t *pipes;
 static int num_pipes, num_active, num_writes;
 static struct event *events;
+static struct nb_perf perf;
+static struct nb_perf_values perf_total; /* timed part of all runs */
 
 
 static void
@@ -96,7 +103,9 @@ run_once(void)
 {
 	evutil_socket_t *cp, space;
 	long i;
+	int c;
 	static struct timeval ts, te;
+	struct nb_perf_values perf_start, perf_end, perf_run;
 
 	for (cp = pipes, i = 0; i < num_pipes; i++, cp += 2) {
 		if (event_initialized(&events[i]))
@@ -116,18 +125,26 @@ run_once(void)
 	count = 0;
 	writes = num_writes;
 	{ int xcount = 0;
+	nb_perf_read(&perf, &perf_start);
 	evutil_gettimeofday(&ts, NULL);
 	do {
 		event_loop(EVLOOP_ONCE | EVLOOP_NONBLOCK);
 		xcount++;
 	} while (count != fired);
 	evutil_gettimeofday(&te, NULL);
+	nb_perf_read(&perf, &perf_end);
 
 	if (xcount != count) fprintf(stderr, "Xcount: %d, Rcount: %d\n", xcount, count);
 	}
 
 	evutil_timersub(&te, &ts, &te);
 
+	nb_perf_diff(&perf_run, &perf_end, &perf_start);
+	for (c = 0; c < NB_PERF_COUNTERS; c++) {
+		perf_total.values[c] += perf_run.values[c];
+		perf_total.valid[c] = perf_total.valid[c] && perf_run.valid[c];
+	}
+
 	return (&te);
 }
 
@@ -138,8 +155,17 @@ main(int argc, char **argv)
 	struct rlimit rl;
 #endif
 	int i, c;
+	int perf_enabled = 0;
 	struct timeval *tv;
 	evutil_socket_t *cp;
+	enum nb_format format = NB_FORMAT_TABLE;
+	FILE *runs_out;
+	struct nb_result result;
+	long us, sum = 0, min_us = 0, max_us = 0;
+	static struct option long_options[] = {
+		{"format", required_argument, 0, 'F'},
+		{"perf", no_argument, 0, 'P'},
+		{0, 0, 0, 0}};
 
 #ifdef _WIN32
 	WSADATA WSAData;
@@ -148,7 +174,7 @@ main(int argc, char **argv)
 	num_pipes = 100;
 	num_active = 1;
 	num_writes = num_pipes;
-	while ((c = getopt(argc, argv, "n:a:w:")) != -1) {
+	while ((c = getopt_long(argc, argv, "n:a:w:", long_options, NULL)) != -1) {
 		switch (c) {
 		case 'n':
 			num_pipes = atoi(optarg);
@@ -159,6 +185,13 @@ main(int argc, char **argv)
 		case 'w':
 			num_writes = atoi(optarg);
 			break;
+		case 'F':
+			if (nb_format_parse(optarg, &format) == -1)
+				exit(1);
+			break;
+		case 'P':
+			perf_enabled = 1;
+			break;
 		default:
 			fprintf(stderr, "Illegal argument \"%c\"\n", c);
 			exit(1);
@@ -182,6 +215,13 @@ main(int argc, char **argv)
 
 	event_init();
 
+	/* single thread: the event loop is the main thread */
+	if (nb_perf_init(&perf, perf_enabled) == -1)
+		exit(1);
+	nb_perf_attach(&perf);
+	for (c = 0; c < NB_PERF_COUNTERS; c++)
+		perf_total.valid[c] = 1;
+
 	for (cp = pipes, i = 0; i < num_pipes; i++, cp += 2) {
 #ifdef USE_PIPES
 		if (pipe(cp) == -1) {
@@ -193,16 +233,37 @@ main(int argc, char **argv)
 		}
 	}
 
-    long sum = 0;
-	for (i = 0; i < 25; i++) {
+	/* per-run times, stdout is kept for result record in machine-readable formats */
+	runs_out = format == NB_FORMAT_TABLE ? stdout : stderr;
+	for (i = 0; i < RUNS; i++) {
 		tv = run_once();
 		if (tv == NULL)
 			exit(1);
-		fprintf(stdout, "%ld\n",
-			tv->tv_sec * 1000000L + tv->tv_usec);
-        sum += tv->tv_sec * 1000000L + tv->tv_usec;
+		us = tv->tv_sec * 1000000L + tv->tv_usec;
+		fprintf(runs_out, "%ld\n", us);
+		sum += us;
+		if (i == 0 || us < min_us)
+			min_us = us;
+		if (us > max_us)
+			max_us = us;
 	}
-    fprintf(stdout, "%s Average : %ld\n", argv[0], sum/25);
+
+	nb_result_init(&result);
+	nb_result_str(&result, "engine", "Engine", "ioevent_bench");
+	nb_result_str(&result, "backend", "Backend", event_get_method());
+	nb_result_int(&result, "pipes", "Pipes", num_pipes);
+	nb_result_int(&result, "active", "Active", num_active);
+	nb_result_int(&result, "writes", "Writes", num_writes);
+	nb_result_int(&result, "runs", "Runs", RUNS);
+	nb_result_int(&result, "avg_us", "Average: us", sum / RUNS);
+	nb_result_int(&result, "min_us", "min us", min_us);
+	nb_result_int(&result, "max_us", "max us", max_us);
+	nb_result_double(&result, "ns_per_event", "ns/event", 1000.0 * sum / RUNS / (num_writes + num_active), 3);
+	nb_result_int(&result, "failures", "Failures", failures);
+	if (perf_enabled)
+		nb_result_perf(&result, NULL, &perf, &perf_total, (double)RUNS * (num_writes + num_active), "event");
+	nb_perf_free(&perf);
+	nb_result_print(stdout, format, &result, 1);
 
 	exit(0);
 }
@@ -7,22 +7,52 @@
 
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 
 #include <sys/resource.h>
 #include <sys/time.h>
 #include <sys/types.h>
 
+#include <errno.h>
+#include <getopt.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-int64_t total_bytes_read = 0;
-int64_t total_messages_read = 0;
-
-int64_t total_errors = 0;
+#include <netbench/affinity.h>
+#include <netbench/clock.h>
+#include <netbench/cputime.h>
+#include <netbench/frame.h>
+#include <netbench/inflight.h>
+#include <netbench/perf.h>
+#include <netbench/ready.h>
+#include <netbench/report.h>
+#include <netbench/result.h>
+#include <netbench/sizes.h>
+#include <netbench/stats.h>
+#include <netbench/verify.h>
+
+#include "evmem.h"
+#include "server.h"
+
+struct session
+{
+    struct bufferevent * bev;
+    struct nb_stats_slot * slot;
+    struct nb_inflight inflight; /* messages in flight, up to depth */
+    const char * message; /* payload pattern, max size */
+    const struct nb_sizes * sizes; /* payload size distribution */
+    uint64_t sizes_state;
+    int framed;
+    int verify; /* stamp messages with sequence and CRC32C, check echo */
+    struct nb_verify verify_state;
+    uint64_t interval_ns; /* open-loop send interval, 0 for closed-loop */
+    uint64_t next_send_ns; /* scheduled time of next open-loop message */
+    struct event * timer; /* open-loop send timer */
+};
 
 static void set_tcp_no_delay(evutil_socket_t fd)
 {
@@ -30,71 +60,576 @@ static void set_tcp_no_delay(evutil_socket_t fd)
     setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
 }
 
+/* Shared by client threads, read-only after start */
+struct client_config
+{
+    struct sockaddr_in sin;
+    const char * message; /* payload pattern, max size */
+    const struct nb_sizes * sizes;
+    int session_count; /* of all threads */
+    int depth;
+    int framed;
+    int verify;
+    double rate; /* of all sessions */
+    const struct nb_cpus * cpus;
+    struct nb_perf * perf;
+    struct nb_cputime * cputime;
+    struct nb_stats * stats;
+    struct measure * measure;
+};
+
+/* Client thread: event base with its slice of sessions and counters slot, shard 0 runs in main() and owns measurement */
+struct shard
+{
+    const struct client_config * config;
+    size_t index;
+    pthread_t tid;
+    struct event_base * base;
+    const char * backend;
+    struct session * sessions;
+    int first_session; /* index over all threads, seeds payload sizes */
+    int session_count;
+    int stop_fd; /* eventfd: stop request from shard 0, event base is not locked for other threads */
+    struct event * stop_ev;
+    const char * error;
+};
+
+static struct shard * shards;
+static size_t shard_count;
+static pthread_barrier_t shards_started;
+
+static void stop_cb(evutil_socket_t fd, short what, void * arg)
+{
+    struct shard * sh = arg;
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) != sizeof(count) && errno != EAGAIN)
+    {
+        perror("client stop");
+    }
+    event_base_loopexit(sh->base, NULL);
+}
+
+static void shards_stop(void)
+{
+    uint64_t one = 1;
+    size_t i;
+    for (i = 0; i < shard_count; ++i)
+    {
+        if (shards[i].stop_fd != -1 && write(shards[i].stop_fd, &one, sizeof(one)) != sizeof(one))
+        {
+            perror("client stop");
+        }
+    }
+}
+
+/* Measurement after warmup, with optional interval reports */
+struct measure
+{
+    struct nb_stats * stats;
+    struct timeval warmup;
+    struct timeval duration;
+    struct timeval interval;
+    struct event * start_ev;
+    struct event * interval_ev;
+    struct event * stop_ev;
+    FILE * report_out; /* interval reports, stderr keeps stdout for machine-readable result */
+    struct nb_stats_window window;
+    struct nb_stats_window interval_window;
+    struct nb_perf * client_perf;
+    struct nb_perf * server_perf; /* NULL for external server */
+    struct nb_perf_values client_perf_start;
+    struct nb_perf_values server_perf_start;
+    struct nb_cputime * client_cputime;
+    struct nb_cputime * server_cputime; /* NULL for external server */
+    struct nb_cputime_values client_cputime_start;
+    struct nb_cputime_values server_cputime_start;
+    uint64_t server_allocations_start;
+    /* results */
+    struct nb_counters counters;
+    struct nb_histogram latency;
+    uint64_t elapsed_ns;
+    struct nb_perf_values client_perf_values;
+    struct nb_perf_values server_perf_values;
+    struct nb_cputime_values client_cputime_values;
+    struct nb_cputime_values server_cputime_values;
+    uint64_t server_allocations;
+};
+
 static void timeoutcb(evutil_socket_t fd, short what, void * arg)
 {
-    struct event_base * base = arg;
+    struct measure * m = arg;
+    struct nb_perf_values perf_end;
+    struct nb_cputime_values cputime_end;
+    m->elapsed_ns = nb_stats_window_get(&m->window, m->stats, &m->counters, &m->latency);
+    nb_perf_read(m->client_perf, &perf_end);
+    nb_perf_diff(&m->client_perf_values, &perf_end, &m->client_perf_start);
+    nb_cputime_read(m->client_cputime, &cputime_end);
+    nb_cputime_diff(&m->client_cputime_values, &cputime_end, &m->client_cputime_start);
+    if (m->server_perf)
+    {
+        nb_perf_read(m->server_perf, &perf_end);
+        nb_perf_diff(&m->server_perf_values, &perf_end, &m->server_perf_start);
+        nb_cputime_read(m->server_cputime, &cputime_end);
+        nb_cputime_diff(&m->server_cputime_values, &cputime_end, &m->server_cputime_start);
+        m->server_allocations = server_allocations() - m->server_allocations_start;
+    }
     fprintf(stderr, "client shutdown\n");
 
-    event_base_loopexit(base, NULL);
+    shards_stop();
+}
+
+static void intervalcb(evutil_socket_t fd, short what, void * arg)
+{
+    struct measure * m = arg;
+    struct nb_counters counters;
+    struct nb_histogram latency;
+    uint64_t elapsed_ns = nb_stats_window_next(&m->interval_window, m->stats, &counters, &latency);
+    nb_report_interval(m->report_out, m->interval_window.start_ns - m->window.start_ns, elapsed_ns, &counters, &latency);
+}
+
+/* Warmup is done */
+static void startcb(evutil_socket_t fd, short what, void * arg)
+{
+    struct measure * m = arg;
+    nb_stats_window_start(&m->window, m->stats);
+    nb_perf_read(m->client_perf, &m->client_perf_start);
+    nb_cputime_read(m->client_cputime, &m->client_cputime_start);
+    if (m->server_perf)
+    {
+        nb_perf_read(m->server_perf, &m->server_perf_start);
+        nb_cputime_read(m->server_cputime, &m->server_cputime_start);
+        m->server_allocations_start = server_allocations();
+    }
+    if (m->interval.tv_sec || m->interval.tv_usec)
+    {
+        m->interval_window = m->window;
+        nb_report_interval_header(m->report_out);
+        evtimer_add(m->interval_ev, &m->interval);
+    }
+    evtimer_add(m->stop_ev, &m->duration);
+}
+
+/*
+ * Queue messages up to depth.
+ * In open-loop mode only already due messages are queued, latency is measured from scheduled send time
+ * (coordinated omission correction), timer is armed for next one, if there is space for it (otherwise ack refills).
+ */
+static void session_fill(struct session * s)
+{
+    struct evbuffer * output = bufferevent_get_output(s->bev);
+    uint64_t now = nb_time_ns();
+    uint64_t start_ns;
+    uint64_t stamp_ns = 0; /* messages are sent together after the batch is stamped */
+    size_t payload_size, length = 0, count = 0;
+    char header[NB_FRAME_HEADER_SIZE];
+
+    while (nb_inflight_space(&s->inflight) > 0)
+    {
+        start_ns = now;
+        if (s->interval_ns)
+        {
+            if (s->next_send_ns > now)
+            {
+                if (!evtimer_pending(s->timer, NULL))
+                {
+                    struct timeval tv;
+                    uint64_t delay = s->next_send_ns - now;
+                    tv.tv_sec = (time_t)(delay / 1000000000);
+                    tv.tv_usec = (suseconds_t)((delay % 1000000000) / 1000);
+                    evtimer_add(s->timer, &tv);
+                }
+                break;
+            }
+            start_ns = s->next_send_ns;
+            s->next_send_ns += s->interval_ns;
+        }
+        payload_size = nb_sizes_next(s->sizes, &s->sizes_state);
+        if (s->verify && payload_size < NB_VERIFY_TRAILER)
+        {
+            payload_size = NB_VERIFY_TRAILER;
+        }
+        if (s->framed)
+        {
+            nb_frame_header_write(header, (uint32_t)payload_size);
+            evbuffer_add(output, header, NB_FRAME_HEADER_SIZE);
+            length += NB_FRAME_HEADER_SIZE;
+        }
+        if (s->verify)
+        {
+            /* pattern, then trailer with CRC32C of header, pattern and sequence */
+            uint64_t verify_start = nb_time_ns();
+            uint64_t verify_ns;
+            char trailer[NB_VERIFY_TRAILER];
+            uint32_t crc = NB_CRC32C_INIT;
+            if (s->framed)
+            {
+                crc = nb_crc32c_update(crc, header, NB_FRAME_HEADER_SIZE);
+            }
+            crc = nb_crc32c_update(crc, s->message, payload_size - NB_VERIFY_TRAILER);
+            nb_verify_trailer(&s->verify_state, crc, trailer);
+            evbuffer_add(output, s->message, payload_size - NB_VERIFY_TRAILER);
+            evbuffer_add(output, trailer, NB_VERIFY_TRAILER);
+            verify_ns = nb_time_ns() - verify_start;
+            nb_stats_verify(s->slot, verify_ns, 0);
+            stamp_ns += verify_ns;
+        }
+        else
+        {
+            evbuffer_add(output, s->message, payload_size);
+        }
+        length += payload_size;
+        nb_inflight_push(&s->inflight, start_ns, s->framed ? NB_FRAME_HEADER_SIZE + payload_size : payload_size);
+        ++count;
+    }
+    if (stamp_ns)
+    {
+        nb_inflight_delay(&s->inflight, count, stamp_ns);
+    }
+    if (length > 0)
+    {
+        nb_stats_write(s->slot, length);
+    }
+}
+
+static void sendcb(evutil_socket_t fd, short what, void * arg)
+{
+    session_fill(arg);
 }
 
 static void readcb(struct bufferevent * bev, void * ctx)
 {
     /* This callback is invoked when there is data to read on bev. */
+    struct session * s = ctx;
     struct evbuffer * input = bufferevent_get_input(bev);
-    struct evbuffer * output = bufferevent_get_output(bev);
+    size_t length = evbuffer_get_length(input);
+    size_t completed = 0;
+    uint64_t now = nb_time_ns();
 
-    ++total_messages_read;
-    total_bytes_read += evbuffer_get_length(input);
+    nb_stats_read(s->slot, length);
+    if (s->verify)
+    {
+        /* check input chain in place, extent by extent (verify needs sizes of messages in flight before ack) */
+        struct evbuffer_iovec vec;
+        size_t corrupted = 0;
+        uint64_t verify_ns = 0; /* of checks only, ack and drain are the same as without verify */
+        while (evbuffer_peek(input, -1, NULL, &vec, 1) > 0 && vec.iov_len > 0)
+        {
+            uint64_t check_ns = nb_time_ns();
+            corrupted += nb_verify_check(&s->verify_state, &s->inflight, vec.iov_base, vec.iov_len);
+            verify_ns += nb_time_ns() - check_ns;
+            completed += nb_inflight_ack(&s->inflight, vec.iov_len, now, s->slot);
+            evbuffer_drain(input, vec.iov_len);
+        }
+        nb_stats_verify(s->slot, verify_ns, corrupted);
+    }
+    else
+    {
+        evbuffer_drain(input, length);
+        completed = nb_inflight_ack(&s->inflight, length, now, s->slot);
+    }
 
-    /* Copy all the data from the input buffer to the output buffer. */
-    evbuffer_add_buffer(output, input);
+    /* Replace completed messages with new ones */
+    if (completed > 0)
+    {
+        session_fill(s);
+    }
 }
 
-static void eventcb(struct bufferevent * bev, short events, void * ptr)
+static void eventcb(struct bufferevent * bev, short events, void * ctx)
 {
+    struct session * s = ctx;
     if (events & BEV_EVENT_CONNECTED)
     {
         evutil_socket_t fd = bufferevent_getfd(bev);
         set_tcp_no_delay(fd);
+        nb_stats_session(s->slot);
+        /* first open-loop send is at random offset in interval, so sessions don't send in bursts */
+        s->next_send_ns = nb_time_ns();
+        if (s->interval_ns)
+        {
+            s->next_send_ns += s->sizes_state % s->interval_ns;
+        }
+        session_fill(s);
     }
     else if (events & BEV_EVENT_ERROR)
     {
-        total_errors++;
+        nb_stats_error(s->slot);
         fprintf(stderr, "NOT Connected\n");
     }
 }
 
-extern struct event_base * server_base;
+static const char * shard_init(struct shard * sh)
+{
+    const struct client_config * config = sh->config;
+    struct event_config * cfg;
+    int i;
+
+    /* epoll timeouts have ms resolution, late open-loop timers would be counted as latency */
+    cfg = event_config_new();
+    if (config->rate > 0)
+    {
+        event_config_set_flag(cfg, EVENT_BASE_FLAG_PRECISE_TIMER);
+    }
+    sh->base = event_base_new_with_config(cfg);
+    event_config_free(cfg);
+    if (!sh->base)
+    {
+        return "Couldn't open event base";
+    }
+    sh->backend = event_base_get_method(sh->base);
+    sh->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (sh->stop_fd == -1)
+    {
+        return "Couldn't create eventfd";
+    }
+    sh->stop_ev = event_new(sh->base, sh->stop_fd, EV_READ, stop_cb, sh);
+    event_add(sh->stop_ev, NULL);
+
+    sh->sessions = calloc((size_t)sh->session_count, sizeof(struct session));
+    if (sh->sessions == NULL)
+    {
+        return "Couldn't allocate session";
+    }
+    for (i = 0; i < sh->session_count; ++i)
+    {
+        struct session * s = &sh->sessions[i];
+        struct bufferevent * bev = bufferevent_socket_new(sh->base, -1, BEV_OPT_CLOSE_ON_FREE);
+
+        s->bev = bev;
+        s->slot = nb_stats_get_slot(config->stats, sh->index);
+        s->message = config->message;
+        s->sizes = config->sizes;
+        s->sizes_state = nb_sizes_seed((uint64_t)(sh->first_session + i + 1));
+        s->framed = config->framed;
+        s->verify = config->verify;
+        nb_verify_init(&s->verify_state);
+        s->interval_ns = config->rate > 0 ? (uint64_t)(1e9 * config->session_count / config->rate) : 0;
+        s->next_send_ns = 0;
+        s->timer = evtimer_new(sh->base, sendcb, s);
+        if (nb_inflight_init(&s->inflight, (size_t)config->depth) == -1)
+        {
+            return "Couldn't allocate session";
+        }
+
+        /* messages are sent after connect */
+        bufferevent_setcb(bev, readcb, NULL, eventcb, s);
+        bufferevent_enable(bev, EV_READ | EV_WRITE);
+
+        if (bufferevent_socket_connect(bev, (struct sockaddr *)&config->sin, sizeof(config->sin)) < 0)
+        {
+            /* Error starting connection */
+            return "error connect";
+        }
+    }
+    return NULL;
+}
+
+static void * shard_run(void * arg)
+{
+    struct shard * sh = arg;
+    const struct client_config * config = sh->config;
+    struct measure * m = config->measure;
+    const char * error = NULL;
+    int placed;
+    size_t i;
+
+    /* before event base, sessions and buffers are allocated, unpinned thread would be recorded as placed */
+    placed = nb_thread_place(nb_cpus_get(config->cpus, sh->index));
+    nb_perf_attach(config->perf);
+    nb_cputime_attach(config->cputime);
+    evmem_attach(&nb_stats_get_slot(config->stats, sh->index)->counters.allocations, 0);
+
+    sh->error = placed == -1 ? "Couldn't place client thread" : shard_init(sh);
+    if (sh->error)
+    {
+        puts(sh->error);
+    }
+    pthread_barrier_wait(&shards_started);
+    for (i = 0; i < shard_count && !error; ++i)
+    {
+        error = shards[i].error;
+    }
 
-void * server_thread(int * port);
+    if (sh->index == 0 && !error)
+    {
+        /* warmup starts when sessions of all threads are connecting */
+        m->start_ev = evtimer_new(sh->base, startcb, m);
+        m->interval_ev = event_new(sh->base, -1, EV_PERSIST, intervalcb, m);
+        m->stop_ev = evtimer_new(sh->base, timeoutcb, m);
+        evtimer_add(m->start_ev, &m->warmup);
+    }
+    if (!error)
+    {
+        event_base_dispatch(sh->base);
+    }
+
+    if (sh->index == 0 && m->start_ev)
+    {
+        event_free(m->start_ev);
+        event_free(m->interval_ev);
+        event_free(m->stop_ev);
+    }
+    for (i = 0; sh->sessions && i < (size_t)sh->session_count; ++i)
+    {
+        if (sh->sessions[i].bev)
+        {
+            bufferevent_free(sh->sessions[i].bev);
+            event_free(sh->sessions[i].timer);
+            nb_inflight_free(&sh->sessions[i].inflight);
+        }
+    }
+    free(sh->sessions);
+    if (sh->stop_ev)
+    {
+        event_free(sh->stop_ev);
+    }
+    if (sh->base)
+    {
+        event_base_free(sh->base);
+    }
+    evmem_detach();
+    return NULL;
+}
+
+static double allocs_per_msg(uint64_t allocations, const struct nb_counters * counters)
+{
+    return counters->messages ? (double)allocations / (double)counters->messages : 0.0;
+}
 
 int main(int argc, char ** argv)
 {
 #ifndef WIN32
     struct rlimit rl;
 #endif
-    struct event_base * base;
-    struct bufferevent ** bevs;
-    struct sockaddr_in sin;
-    struct event * evtimeout;
-    struct timeval timeout;
+    struct client_config config;
+    struct measure measure;
+    struct nb_stats stats;
+    const char * error = NULL;
+    size_t k;
     int i, c;
 
     char * host = "127.0.0.1";
     int port = 9876;
     int block_size = 16384;
+    int depth = 1;
+    double rate = 0;
+    char rate_str[32];
+    int framed = 0;
+    int verify = 0;
+    const char * sizes_spec = NULL;
+    char fixed_spec[32];
+    struct nb_sizes sizes;
+    struct server_options s_options;
     int session_count = 0;
+    int client_threads = 1;
     int seconds = 60;
+    int warmup = 0;
+    double interval = 0;
+    enum nb_format format = NB_FORMAT_TABLE;
+    const char * server_cpus_spec = NULL;
+    const char * client_cpus_spec = NULL;
+    struct nb_cpus server_cpus = {NULL, 0};
+    struct nb_cpus client_cpus = {NULL, 0};
+    int perf = 0;
+    struct nb_perf client_perf;
+    struct nb_perf server_perf;
+    struct nb_cputime client_cputime;
+    struct nb_cputime server_cputime;
+    char nodes[64];
+    const char * backend;
+    struct nb_result result;
     int client_start = 0;
     int server_start = 1;
+    int server_threads = 1;
+    int handoff = 0;
+    int echo_pool = 0;
+    const char * server_accept;
+    int ready_fd = -1;
+    int ready_fds[2];
     pthread_t server_tid = 0;
     pthread_attr_t attr;
 
-    while ((c = getopt(argc, argv, ":a:b:n:d:h")) != -1)
+    static struct option long_options[] = {
+        {"warmup", required_argument, 0, 'W'},
+        {"interval", required_argument, 0, 'I'},
+        {"verify", no_argument, 0, 'V'},
+        {"format", required_argument, 0, 'F'},
+        {"server-cpus", required_argument, 0, 'E'},
+        {"client-cpus", required_argument, 0, 'C'},
+        {"perf", no_argument, 0, 'P'},
+        {"ready-fd", required_argument, 0, 'R'},
+        {"accept", required_argument, 0, 'A'},
+        {"echo-alloc", required_argument, 0, 'M'},
+        {0, 0, 0, 0}};
+
+    while ((c = getopt_long(argc, argv, ":a:p:b:s:q:r:fn:d:t:T:h", long_options, NULL)) != -1)
     {
         switch (c)
         {
+            case 'W':
+                warmup = atoi(optarg);
+                break;
+            case 'I':
+                interval = atof(optarg);
+                break;
+            case 'V':
+                verify = 1;
+                break;
+            case 'E':
+                server_cpus_spec = optarg;
+                break;
+            case 'C':
+                client_cpus_spec = optarg;
+                break;
+            case 'P':
+                perf = 1;
+                break;
+            case 'R':
+                ready_fd = atoi(optarg);
+                break;
+            case 'A':
+                if (strcmp(optarg, "reuseport") == 0)
+                {
+                    handoff = 0;
+                }
+                else if (strcmp(optarg, "handoff") == 0)
+                {
+                    handoff = 1;
+                }
+                else
+                {
+                    fprintf(stderr, "Invalid accept \"%s\", must be reuseport or handoff\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 't':
+                client_threads = atoi(optarg);
+                break;
+            case 'M':
+                if (strcmp(optarg, "heap") == 0)
+                {
+                    echo_pool = 0;
+                }
+                else if (strcmp(optarg, "pool") == 0)
+                {
+                    echo_pool = 1;
+                }
+                else
+                {
+                    fprintf(stderr, "Invalid echo allocator \"%s\", must be heap or pool\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'T':
+                server_threads = atoi(optarg);
+                break;
+            case 'F':
+                if (nb_format_parse(optarg, &format) == -1)
+                {
+                    exit(1);
+                }
+                break;
             case 'a':
                 host = optarg;
                 server_start = 0;
@@ -105,6 +640,18 @@ int main(int argc, char ** argv)
             case 'b':
                 block_size = atoi(optarg);
                 break;
+            case 's':
+                sizes_spec = optarg;
+                break;
+            case 'q':
+                depth = atoi(optarg);
+                break;
+            case 'r':
+                rate = atof(optarg);
+                break;
+            case 'f':
+                framed = 1;
+                break;
             case 'n':
                 session_count = atoi(optarg);
                 break;
@@ -115,6 +662,24 @@ int main(int argc, char ** argv)
                 fprintf(stderr, "Usage: %s -p <port> -b <blocksize> ", argv[0]);
                 fprintf(stderr, "-n <sessions> -d <time>\n");
                 fprintf(stderr, "  [-a server] (by default, start internal server)\n");
+                fprintf(stderr, "  [--ready-fd=fd] (server only: write \"ready\" line to inherited fd when listening, stop on SIGINT/SIGTERM)\n");
+                fprintf(stderr, "  [--warmup=seconds] (run before measurement, excluded from stats, default 0)\n");
+                fprintf(stderr, "  [--interval=seconds] (print throughput and latency per interval, default disabled)\n");
+                fprintf(stderr, "  [--verify] (sequence and CRC32C in each message, check echo, min payload size is 12)\n");
+                fprintf(stderr, "  [--format=table|csv|json] (result output, json is one object per line, default table)\n");
+                fprintf(stderr, "  [--server-cpus=list] [--client-cpus=list] (pin event loop threads round-robin, like 0-3,8,\n");
+                fprintf(stderr, "     memory is preferred from CPU NUMA node, default not pinned)\n");
+                fprintf(stderr, "  [--perf] (cycles, instructions, cache and branch misses, context switches per message of client and server threads)\n");
+                fprintf(stderr, "  [-s sizes] (payload size distribution instead of fixed blocksize, blocksize is set to max size:\n");
+                fprintf(stderr, "     fixed:SIZE uniform:MIN:MAX lognormal:MEDIAN:SIGMA:MAX bimodal:SMALL:LARGE:PERCENT file:PATH)\n");
+                fprintf(stderr, "  [-q depth] (messages in flight per session, default 1)\n");
+                fprintf(stderr, "  [-r rate] (open-loop messages/s for all sessions, latency from scheduled send time, default closed-loop)\n");
+                fprintf(stderr, "  [-f] (length-prefixed frames with blocksize payload, server echoes whole frames)\n");
+                fprintf(stderr, "  [-t client_threads] (sessions sharded across event base per thread, default 1)\n");
+                fprintf(stderr, "  [-T server_threads] (event base per thread, default 1)\n");
+                fprintf(stderr, "  [--accept=reuseport|handoff] (listener per server thread with SO_REUSEPORT,\n");
+                fprintf(stderr, "     or one listener handing accepted sockets to threads round-robin, default reuseport)\n");
+                fprintf(stderr, "  [--echo-alloc=heap|pool] (server evbuffer chain memory, malloc/free per read or recycled per thread, default heap)\n");
                 exit(1);
             }
             default:
@@ -137,25 +702,93 @@ int main(int argc, char ** argv)
             fprintf(stderr, "Invalid block_size\n");
             return 1;
         }
+        if (depth <= 0)
+        {
+            fprintf(stderr, "Invalid depth\n");
+            return 1;
+        }
+        /* send interval is whole nanoseconds, 0 would be closed-loop */
+        if (rate < 0 || (rate > 0 && 1e9 * session_count / rate < 1))
+        {
+            fprintf(stderr, "Invalid rate\n");
+            return 1;
+        }
+        if (warmup < 0 || interval < 0)
+        {
+            fprintf(stderr, "Invalid warmup or interval\n");
+            return 1;
+        }
         if (seconds <= 0)
         {
             fprintf(stderr, "Invalid durations\n");
             return 1;
         }
+        if (client_threads <= 0 || client_threads > session_count)
+        {
+            fprintf(stderr, "Invalid client threads\n");
+            return 1;
+        }
     }
     else if (server_start == 0)
     {
         fprintf(stderr, "Invalid options, nothing started\n");
         return 1;
     }
+    if (server_threads <= 0)
+    {
+        fprintf(stderr, "Invalid server threads\n");
+        return 1;
+    }
+    if (ready_fd != -1 && (client_start || ready_fd < 0))
+    {
+        fprintf(stderr, "Invalid ready fd, it is for server only mode\n");
+        return 1;
+    }
+    if (sizes_spec == NULL)
+    {
+        snprintf(fixed_spec, sizeof(fixed_spec), "fixed:%d", block_size);
+        sizes_spec = fixed_spec;
+    }
+    if (nb_sizes_parse(&sizes, sizes_spec) == -1)
+    {
+        return 1;
+    }
+    block_size = (int)sizes.max;
+    if (verify && block_size < NB_VERIFY_TRAILER)
+    {
+        fprintf(stderr, "Block size must be at least %d for verify\n", NB_VERIFY_TRAILER);
+        return 1;
+    }
+    if (server_cpus_spec && nb_cpus_parse(&server_cpus, server_cpus_spec) == -1)
+    {
+        return 1;
+    }
+    if (client_cpus_spec && nb_cpus_parse(&client_cpus, client_cpus_spec) == -1)
+    {
+        return 1;
+    }
+    if (nb_perf_init(&client_perf, perf) == -1 || nb_perf_init(&server_perf, perf) == -1 || nb_cputime_init(&client_cputime) == -1
+        || nb_cputime_init(&server_cputime) == -1)
+    {
+        return 1;
+    }
 
-    timeout.tv_sec = seconds;
-    timeout.tv_usec = 0;
+    /* counts heap allocations of event loop threads, before anything is allocated by libevent */
+    evmem_init();
 
     signal(SIGPIPE, SIG_IGN);
 
 #ifndef WIN32
-    rl.rlim_cur = rl.rlim_max = session_count * 2 + 50;
+    /* server process does not know client sessions count, takes all it is allowed */
+    if (client_start)
+    {
+        /* both ends of sessions, epoll and eventfd of each event loop thread */
+        rl.rlim_cur = rl.rlim_max = (rlim_t)(session_count * 2 + (client_threads + server_threads) * 2 + 50);
+    }
+    else if (getrlimit(RLIMIT_NOFILE, &rl) == 0)
+    {
+        rl.rlim_cur = rl.rlim_max;
+    }
     if (setrlimit(RLIMIT_NOFILE, &rl) == -1)
     {
         perror("setrlimit");
@@ -163,23 +796,45 @@ int main(int argc, char ** argv)
     }
 #endif
 
+    s_options.port = port;
+    s_options.framed = framed;
+    s_options.max_payload = (size_t)block_size;
+    s_options.threads = (size_t)server_threads;
+    s_options.handoff = handoff;
+    s_options.cpus = &server_cpus;
+    s_options.perf = &server_perf;
+    s_options.cputime = &server_cputime;
+    s_options.echo_pool = echo_pool;
+
     if (server_start)
     {
         if (client_start)
         {
             int perr;
+            if (pipe(ready_fds) == -1)
+            {
+                perror("pipe");
+                return 1;
+            }
+            s_options.ready_fd = ready_fds[1];
+            s_options.stop_signals = 0;
             pthread_attr_init(&attr);
-            perr = pthread_create(&server_tid, &attr, &server_thread, &port);
+            perr = pthread_create(&server_tid, &attr, (void * (*)(void *))server_thread, &s_options);
             if (perr != 0)
             {
                 perror(strerror(perr));
                 return 1;
             }
-            sleep(1);
+            if (nb_ready_wait(ready_fds[0], 10000) == -1)
+            {
+                return 1;
+            }
         }
         else
         {
-            if (server_thread(&port) != NULL)
+            s_options.ready_fd = ready_fd;
+            s_options.stop_signals = 1;
+            if (server_thread(&s_options) != NULL)
             {
                 return 1;
             }
@@ -188,86 +843,175 @@ int main(int argc, char ** argv)
 
     if (client_start)
     {
-        base = event_base_new();
-        if (!base)
+        char * message = malloc((size_t)block_size);
+        for (i = 0; i < block_size; ++i)
         {
-            puts("Couldn't open event base");
-            return 1;
+            message[i] = (char)(i % 128);
         }
 
-        char * message = malloc(block_size);
-        for (i = 0; i < block_size; ++i)
+        /* counters slot per client thread */
+        if (nb_stats_init(&stats, (size_t)client_threads) == -1)
         {
-            message[i] = i % 128;
+            puts("Couldn't allocate stats");
+            return 1;
         }
 
-        evtimeout = evtimer_new(base, timeoutcb, base);
-        evtimer_add(evtimeout, &timeout);
-
-        memset(&sin, 0, sizeof(sin));
-        sin.sin_family = AF_INET;
-        sin.sin_addr.s_addr = inet_addr(host);
-        sin.sin_port = htons(port);
-
-        bevs = malloc(session_count * sizeof(struct bufferevent *));
-        for (i = 0; i < session_count; ++i)
+        memset(&measure, 0, sizeof(measure));
+        measure.stats = &stats;
+        measure.warmup.tv_sec = warmup;
+        measure.duration.tv_sec = seconds;
+        measure.interval.tv_sec = (time_t)interval;
+        measure.interval.tv_usec = (suseconds_t)((interval - (double)(time_t)interval) * 1000000);
+        measure.report_out = format == NB_FORMAT_TABLE ? stdout : stderr;
+        measure.client_perf = &client_perf;
+        measure.server_perf = server_start ? &server_perf : NULL;
+        measure.client_cputime = &client_cputime;
+        measure.server_cputime = server_start ? &server_cputime : NULL;
+
+        memset(&config, 0, sizeof(config));
+        config.sin.sin_family = AF_INET;
+        config.sin.sin_addr.s_addr = inet_addr(host);
+        config.sin.sin_port = htons((uint16_t)port);
+        config.message = message;
+        config.sizes = &sizes;
+        config.session_count = session_count;
+        config.depth = depth;
+        config.framed = framed;
+        config.verify = verify;
+        config.rate = rate;
+        config.cpus = &client_cpus;
+        config.perf = &client_perf;
+        config.cputime = &client_cputime;
+        config.stats = &stats;
+        config.measure = &measure;
+
+        /* sessions are sharded over threads, remainder goes to first shards */
+        shard_count = (size_t)client_threads;
+        shards = aligned_alloc(NB_CACHE_LINE, shard_count * sizeof(struct shard));
+        if (shards == NULL)
         {
-            struct bufferevent * bev = bufferevent_socket_new(base, -1, BEV_OPT_CLOSE_ON_FREE);
-
-            bufferevent_setcb(bev, readcb, NULL, eventcb, NULL);
-            bufferevent_enable(bev, EV_READ | EV_WRITE);
-            evbuffer_add(bufferevent_get_output(bev), message, block_size);
+            puts("Couldn't allocate client threads");
+            return 1;
+        }
+        memset(shards, 0, shard_count * sizeof(struct shard));
+        pthread_barrier_init(&shards_started, NULL, (unsigned)shard_count);
+        for (k = 0, i = 0; k < shard_count; ++k)
+        {
+            shards[k].config = &config;
+            shards[k].index = k;
+            shards[k].first_session = i;
+            shards[k].session_count = session_count / client_threads + ((int)k < session_count % client_threads ? 1 : 0);
+            shards[k].stop_fd = -1;
+            i += shards[k].session_count;
+        }
+        for (k = 1; k < shard_count; ++k)
+        {
+            int err = pthread_create(&shards[k].tid, NULL, shard_run, &shards[k]);
+            if (err != 0)
+            {
+                /* started shards wait for all on barrier */
+                fprintf(stderr, "Couldn't start client thread: %s\n", strerror(err));
+                exit(1);
+            }
+        }
+        shard_run(&shards[0]);
 
-            if (bufferevent_socket_connect(bev, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+        for (k = 1; k < shard_count; ++k)
+        {
+            pthread_join(shards[k].tid, NULL);
+        }
+        for (k = 0; k < shard_count; ++k)
+        {
+            if (shards[k].stop_fd != -1)
+            {
+                close(shards[k].stop_fd);
+            }
+            if (shards[k].error && !error)
             {
-                /* Error starting connection */
-                bufferevent_free(bev);
-                puts("error connect");
-                return -1;
+                error = shards[k].error;
             }
-            bevs[i] = bev;
         }
+        backend = shards[0].backend;
+        pthread_barrier_destroy(&shards_started);
+        free(shards);
+        shards = NULL;
+        shard_count = 0;
+        free(message);
 
-        event_base_dispatch(base);
+        nb_stats_free(&stats);
+        if (error)
+        {
+            return 1;
+        }
 
-        for (i = 0; i < session_count; ++i)
+        /* latency of open-loop is measured from scheduled send time */
+        if (rate > 0)
         {
-            bufferevent_free(bevs[i]);
+            snprintf(rate_str, sizeof(rate_str), "%.0f", rate);
+        }
+        else
+        {
+            snprintf(rate_str, sizeof(rate_str), "closed");
         }
-        free(bevs);
-        event_free(evtimeout);
-        event_base_free(base);
-        free(message);
 
-        printf(
-            "%20s %8s %6s %18s %18s %10s %12s %18s %18s\n",
-            "Write buffer (bytes)",
-            "Clients",
-            "Errors",
-            "Avg messages size",
-            "Throughtput: MiB/s",
-            "Msg/s",
-            "us/msg",
-            "Total read: bytes",
-            "messages");
-        printf(
-            "%20d %8d %6zd %18.3f %18.3f %10ld %12.3f %18zd %18zd\n",
-            block_size,
-            session_count,
-            total_errors,
-            (double)total_bytes_read / total_messages_read,
-            (double)total_bytes_read / (timeout.tv_sec * 1024 * 1024),
-            total_messages_read / seconds,
-            (double)100000 * seconds / total_messages_read,
-            total_bytes_read,
-            total_messages_read);
+        nb_result_init(&result);
+        nb_result_str(&result, "engine", "Engine", "event_pp");
+        nb_result_str(&result, "backend", "Backend", backend);
+        nb_result_int(&result, "block_size", "Write buffer (bytes)", block_size);
+        nb_result_str(&result, "sizes", "Sizes", sizes_spec);
+        nb_result_int(&result, "depth", "Depth", depth);
+        nb_result_str(&result, "rate", "Rate/s", rate_str);
+        nb_result_str(&result, "framing", "Framing", framed ? "frame" : "stream");
+        nb_result_str(&result, "verify", "Verify", verify ? nb_crc32c_impl() : "off");
+        nb_result_int(&result, "sessions", "Sessions", session_count);
+        nb_result_int(&result, "threads", "Threads", client_threads);
+        nb_result_int(&result, "servers", "Servers", server_start ? server_threads : 0);
+        nb_result_int(&result, "duration_s", "Duration: s", seconds);
+        nb_result_int(&result, "warmup_s", "Warmup: s", warmup);
+        nb_cpus_nodes(&client_cpus, (size_t)client_threads, nodes, sizeof(nodes));
+        nb_result_str(&result, "client_cpus", "Client CPUs", client_cpus_spec ? client_cpus_spec : "-");
+        nb_result_str(&result, "client_nodes", "Client nodes", nodes);
+        if (server_start)
+        {
+            server_accept = server_threads == 1 ? "single" : handoff ? "handoff" : "reuseport";
+            nb_cpus_nodes(&server_cpus, (size_t)server_threads, nodes, sizeof(nodes));
+            nb_result_str(&result, "server_cpus", "Server CPUs", server_cpus_spec ? server_cpus_spec : "-");
+            nb_result_str(&result, "server_nodes", "Server nodes", nodes);
+            nb_result_str(&result, "server_accept", "Server accept", server_accept);
+            nb_result_str(&result, "echo_alloc", "Echo alloc", echo_pool ? "pool" : "heap");
+        }
+        nb_result_metrics(&result, measure.elapsed_ns, &measure.counters, &measure.latency);
+        nb_result_cputime(&result, "client", &measure.client_cputime_values, measure.elapsed_ns, (double)measure.counters.messages);
+        nb_result_double(&result, "client_allocs_per_msg", "Client allocs/msg", allocs_per_msg(measure.counters.allocations, &measure.counters), 3);
+        if (server_start)
+        {
+            nb_result_double(&result, "server_allocs_per_msg", "Server allocs/msg", allocs_per_msg(measure.server_allocations, &measure.counters), 3);
+            nb_result_cputime(&result, "server", &measure.server_cputime_values, measure.elapsed_ns, (double)measure.counters.messages);
+        }
+        if (perf)
+        {
+            nb_result_perf(&result, "client", &client_perf, &measure.client_perf_values, (double)measure.counters.messages, "msg");
+            if (server_start)
+            {
+                nb_result_perf(&result, "server", &server_perf, &measure.server_perf_values, (double)measure.counters.messages, "msg");
+            }
+        }
+        nb_result_print(stdout, format, &result, 1);
 
         if (server_start)
         {
-            kill(getpid(), SIGINT);
+            server_stop();
             pthread_join(server_tid, NULL);
         }
     }
 
+    nb_sizes_free(&sizes);
+    nb_cpus_free(&server_cpus);
+    nb_cpus_free(&client_cpus);
+    nb_perf_free(&client_perf);
+    nb_perf_free(&server_perf);
+    nb_cputime_free(&client_cputime);
+    nb_cputime_free(&server_cputime);
+
     return 0;
 }
@@ -0,0 +1,164 @@
+/*
+ * libevent memory functions with heap allocations counter and per-thread recycling
+ */
+#include <event2/event.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <netbench/stats.h>
+
+#include "evmem.h"
+
+/* Size classes 2^EVMEM_MIN_SHIFT .. 2^EVMEM_MAX_SHIFT, larger blocks go to heap */
+#define EVMEM_MIN_SHIFT 6
+#define EVMEM_MAX_SHIFT 17
+#define EVMEM_CLASSES (EVMEM_MAX_SHIFT - EVMEM_MIN_SHIFT + 1)
+
+/* Free blocks kept per size class and thread, the rest is returned to heap */
+#define EVMEM_POOL_DEPTH 256
+
+/* Before each block, keeps 16 bytes alignment of malloc */
+struct evmem_header
+{
+    size_t size_class; /* EVMEM_CLASSES - exact size heap block */
+    struct evmem_header * next; /* free list */
+};
+
+struct evmem_thread
+{
+    uint64_t * allocations;
+    int pool;
+    struct evmem_header * free_lists[EVMEM_CLASSES];
+    size_t free_counts[EVMEM_CLASSES];
+};
+
+static __thread struct evmem_thread evmem;
+
+static size_t size_class(size_t size)
+{
+    size_t c = 0;
+    while (c < EVMEM_CLASSES && ((size_t)1 << (c + EVMEM_MIN_SHIFT)) < size)
+    {
+        ++c;
+    }
+    return c;
+}
+
+static void * evmem_malloc(size_t size)
+{
+    size_t c = evmem.pool ? size_class(size) : EVMEM_CLASSES;
+    struct evmem_header * h;
+
+    if (c < EVMEM_CLASSES)
+    {
+        h = evmem.free_lists[c];
+        if (h)
+        {
+            evmem.free_lists[c] = h->next;
+            --evmem.free_counts[c];
+            return h + 1;
+        }
+        size = (size_t)1 << (c + EVMEM_MIN_SHIFT);
+    }
+    if (evmem.allocations)
+    {
+        nb_counter_add(evmem.allocations, 1);
+    }
+    h = malloc(sizeof(*h) + size);
+    if (h == NULL)
+    {
+        return NULL;
+    }
+    h->size_class = c;
+    return h + 1;
+}
+
+static void evmem_free(void * p)
+{
+    struct evmem_header * h;
+    size_t c;
+
+    if (p == NULL)
+    {
+        return;
+    }
+    h = (struct evmem_header *)p - 1;
+    c = h->size_class;
+    /* block of other thread stays in this one */
+    if (evmem.pool && c < EVMEM_CLASSES && evmem.free_counts[c] < EVMEM_POOL_DEPTH)
+    {
+        h->next = evmem.free_lists[c];
+        evmem.free_lists[c] = h;
+        ++evmem.free_counts[c];
+        return;
+    }
+    free(h);
+}
+
+static void * evmem_realloc(void * p, size_t size)
+{
+    struct evmem_header * h;
+    size_t capacity;
+    void * n;
+
+    if (p == NULL)
+    {
+        return evmem_malloc(size);
+    }
+    h = (struct evmem_header *)p - 1;
+    if (h->size_class < EVMEM_CLASSES)
+    {
+        capacity = (size_t)1 << (h->size_class + EVMEM_MIN_SHIFT);
+        if (size <= capacity)
+        {
+            return p;
+        }
+        n = evmem_malloc(size);
+        if (n == NULL)
+        {
+            return NULL;
+        }
+        memcpy(n, p, capacity);
+        evmem_free(p);
+        return n;
+    }
+    if (evmem.allocations)
+    {
+        nb_counter_add(evmem.allocations, 1);
+    }
+    h = realloc(h, sizeof(*h) + size);
+    if (h == NULL)
+    {
+        return NULL;
+    }
+    return h + 1;
+}
+
+void evmem_init(void)
+{
+    event_set_mem_functions(evmem_malloc, evmem_realloc, evmem_free);
+}
+
+void evmem_attach(uint64_t * allocations, int pool)
+{
+    evmem.allocations = allocations;
+    evmem.pool = pool;
+}
+
+void evmem_detach(void)
+{
+    size_t c;
+    for (c = 0; c < EVMEM_CLASSES; ++c)
+    {
+        while (evmem.free_lists[c])
+        {
+            struct evmem_header * h = evmem.free_lists[c];
+            evmem.free_lists[c] = h->next;
+            free(h);
+        }
+        evmem.free_counts[c] = 0;
+    }
+    evmem.allocations = NULL;
+    evmem.pool = 0;
+}
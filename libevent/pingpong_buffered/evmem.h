@@ -0,0 +1,22 @@
+#ifndef _PINGPONG_EVMEM_H
+#define _PINGPONG_EVMEM_H
+
+/*
+ * libevent memory functions: heap allocations counter and recycling of freed blocks per thread.
+ *
+ * evbuffer chains are allocated in power of 2 sizes, in pooling thread a freed block is kept on the thread
+ * free list of its size class and is reused by the next read or write instead of malloc/free per message.
+ */
+
+#include <stdint.h>
+
+/* Replace libevent allocator, must be called before any other libevent function */
+void evmem_init(void);
+
+/* Count heap allocations of calling thread to allocations (single writer, NULL - not counted), recycle freed blocks if pool */
+void evmem_attach(uint64_t * allocations, int pool);
+
+/* Release free lists of calling thread, stop counting */
+void evmem_detach(void);
+
+#endif /* _PINGPONG_EVMEM_H */
@@ -7,12 +7,23 @@
 
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
+#include <sys/eventfd.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include <netbench/affinity.h>
+#include <netbench/frame.h>
+#include <netbench/ready.h>
+#include <netbench/stats.h>
+
+#include "evmem.h"
+#include "server.h"
 
 static void set_tcp_no_delay(evutil_socket_t fd)
 {
@@ -20,14 +31,6 @@ static void set_tcp_no_delay(evutil_socket_t fd)
     setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
 }
 
-static void signal_cb(evutil_socket_t fd, short what, void * arg)
-{
-    struct event_base * base = arg;
-    fprintf(stderr, "server stoping\n");
-
-    event_base_loopexit(base, NULL);
-}
-
 static void echo_read_cb(struct bufferevent * bev, void * ctx)
 {
     /* This callback is invoked when there is data to read on bev. */
@@ -38,6 +41,35 @@ static void echo_read_cb(struct bufferevent * bev, void * ctx)
     evbuffer_add_buffer(output, input);
 }
 
+static void frame_read_cb(struct bufferevent * bev, void * ctx)
+{
+    /* Move only whole frames to the output buffer, incomplete frame stays in input. */
+    struct server_options * options = ctx;
+    struct evbuffer * input = bufferevent_get_input(bev);
+    struct evbuffer * output = bufferevent_get_output(bev);
+    size_t length = evbuffer_get_length(input);
+    size_t size;
+    char header[NB_FRAME_HEADER_SIZE];
+
+    while (length >= NB_FRAME_HEADER_SIZE)
+    {
+        evbuffer_copyout(input, header, NB_FRAME_HEADER_SIZE);
+        size = nb_frame_header_read(header);
+        if (size > options->max_payload)
+        {
+            bufferevent_free(bev);
+            return;
+        }
+        size += NB_FRAME_HEADER_SIZE;
+        if (length < size)
+        {
+            break;
+        }
+        evbuffer_remove_buffer(input, output, size);
+        length -= size;
+    }
+}
+
 static void echo_event_cb(struct bufferevent * bev, short events, void * ctx)
 {
     struct evbuffer * output = bufferevent_get_output(bev);
@@ -49,36 +81,172 @@ static void echo_event_cb(struct bufferevent * bev, short events, void * ctx)
     }
 }
 
-static void accept_conn_cb(struct evconnlistener * listener, evutil_socket_t fd, struct sockaddr * address, int socklen, void * ctx)
+/* Accepted connections in flight from listener thread to one worker, power of 2 */
+#define HANDOFF_QUEUE 4096
+
+/* Single producer (listener thread), single consumer (worker) ring of accepted sockets */
+struct fd_queue
+{
+    size_t head __attribute__((aligned(NB_CACHE_LINE))); /* next to pop, written by consumer */
+    size_t tail __attribute__((aligned(NB_CACHE_LINE))); /* next to push, written by producer */
+    evutil_socket_t fds[HANDOFF_QUEUE];
+};
+
+static int fd_queue_push(struct fd_queue * q, evutil_socket_t fd)
+{
+    size_t tail = q->tail;
+    if (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == HANDOFF_QUEUE)
+    {
+        return -1;
+    }
+    q->fds[tail & (HANDOFF_QUEUE - 1)] = fd;
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int fd_queue_pop(struct fd_queue * q, evutil_socket_t * fd)
+{
+    size_t head = q->head;
+    if (head == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE))
+    {
+        return -1;
+    }
+    *fd = q->fds[head & (HANDOFF_QUEUE - 1)];
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Event loop thread, worker 0 runs in server_thread() caller and owns signals (and the listener in handoff mode) */
+struct worker
+{
+    struct fd_queue queue;
+    struct server_options * options;
+    size_t index;
+    pthread_t tid;
+    struct event_base * base;
+    struct evconnlistener * listener;
+    int notify_fd; /* eventfd: handed off connections and stop request, event base is not locked for other threads */
+    struct event * notify_ev;
+    int stop;
+    const char * error;
+    uint64_t allocations; /* libevent heap allocations of the thread */
+};
+
+static struct worker * workers;
+static size_t worker_count;
+static size_t next_worker; /* handoff round-robin, listener thread only */
+static pthread_barrier_t workers_started;
+
+static void session_start(struct event_base * base, evutil_socket_t fd, struct server_options * options)
 {
-    /* We got a new connection! Set up a bufferevent for it. */
-    struct event_base * base = evconnlistener_get_base(listener);
     struct bufferevent * bev = bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE);
     set_tcp_no_delay(fd);
 
-    bufferevent_setcb(bev, echo_read_cb, NULL, echo_event_cb, NULL);
+    bufferevent_setcb(bev, options->framed ? frame_read_cb : echo_read_cb, NULL, echo_event_cb, options);
 
     bufferevent_enable(bev, EV_READ | EV_WRITE);
 }
 
-struct event_base * server_base;
+static void worker_notify(struct worker * w)
+{
+    uint64_t one = 1;
+    if (write(w->notify_fd, &one, sizeof(one)) != sizeof(one))
+    {
+        perror("worker notify");
+    }
+}
 
-void * server_thread(int * port)
+static void notify_cb(evutil_socket_t fd, short what, void * arg)
 {
-    struct evconnlistener * listener;
+    struct worker * w = arg;
+    evutil_socket_t conn;
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) != sizeof(count) && errno != EAGAIN)
+    {
+        perror("worker notify");
+    }
+    while (fd_queue_pop(&w->queue, &conn) == 0)
+    {
+        session_start(w->base, conn, w->options);
+    }
+    if (__atomic_load_n(&w->stop, __ATOMIC_ACQUIRE))
+    {
+        event_base_loopexit(w->base, NULL);
+    }
+}
+
+void server_stop(void)
+{
+    size_t i;
+    for (i = 0; i < worker_count; ++i)
+    {
+        __atomic_store_n(&workers[i].stop, 1, __ATOMIC_RELEASE);
+        worker_notify(&workers[i]);
+    }
+}
+
+uint64_t server_allocations(void)
+{
+    uint64_t allocations = 0;
+    size_t i;
+    for (i = 0; i < worker_count; ++i)
+    {
+        allocations += nb_counter_load(&workers[i].allocations);
+    }
+    return allocations;
+}
+
+static void signal_cb(evutil_socket_t fd, short what, void * arg)
+{
+    fprintf(stderr, "server stoping\n");
+
+    server_stop();
+}
+
+static void accept_conn_cb(struct evconnlistener * listener, evutil_socket_t fd, struct sockaddr * address, int socklen, void * ctx)
+{
+    /* We got a new connection! Set up a bufferevent for it. */
+    session_start(evconnlistener_get_base(listener), fd, ctx);
+}
+
+static void handoff_accept_cb(struct evconnlistener * listener, evutil_socket_t fd, struct sockaddr * address, int socklen, void * ctx)
+{
+    struct worker * self = ctx;
+    struct worker * w = &workers[next_worker++ % worker_count];
+
+    /* full queue: worker is far behind, listener thread serves the connection */
+    if (w == self || fd_queue_push(&w->queue, fd) == -1)
+    {
+        session_start(self->base, fd, self->options);
+        return;
+    }
+    worker_notify(w);
+}
+
+static const char * worker_init(struct worker * w)
+{
+    struct server_options * options = w->options;
     struct sockaddr_in sin;
-    struct event * evstop;
+    int reuse_port = options->threads > 1 && !options->handoff;
 
-    server_base = event_base_new();
-    if (!server_base)
+    w->base = event_base_new();
+    if (!w->base)
     {
-        char * s = "Couldn't open event base";
-        puts(s);
-        return (void *)s;
+        return "Couldn't open event base";
+    }
+    w->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (w->notify_fd == -1)
+    {
+        return "Couldn't create eventfd";
     }
+    w->notify_ev = event_new(w->base, w->notify_fd, EV_READ | EV_PERSIST, notify_cb, w);
+    event_add(w->notify_ev, NULL);
 
-    evstop = evsignal_new(server_base, SIGHUP, signal_cb, server_base);
-    evsignal_add(evstop, NULL);
+    if (w->index > 0 && !reuse_port)
+    {
+        return NULL;
+    }
     /* Clear the sockaddr before using it, in case there are extra
      *          * platform-specific fields that can mess us up. */
     memset(&sin, 0, sizeof(sin));
@@ -87,22 +255,150 @@ void * server_thread(int * port)
     /* Listen on 0.0.0.0 */
     sin.sin_addr.s_addr = inet_addr("127.0.0.1");
     /* Listen on the given port. */
-    sin.sin_port = htons((unsigned short)*port);
+    sin.sin_port = htons((unsigned short)options->port);
 
-    listener = evconnlistener_new_bind(
-        server_base, accept_conn_cb, NULL, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1, (struct sockaddr *)&sin, sizeof(sin));
-    if (!listener)
+    /* with SO_REUSEPORT kernel spreads incoming connections over listeners of all threads */
+    w->listener = evconnlistener_new_bind(
+        w->base,
+        options->handoff ? handoff_accept_cb : accept_conn_cb,
+        options->handoff ? (void *)w : (void *)options,
+        LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE | (reuse_port ? LEV_OPT_REUSEABLE_PORT : 0),
+        -1,
+        (struct sockaddr *)&sin,
+        sizeof(sin));
+    if (!w->listener)
+    {
+        return "Couldn't create listener";
+    }
+    return NULL;
+}
+
+static void * worker_run(void * arg)
+{
+    static const int stop_signals[] = {SIGHUP, SIGINT, SIGTERM};
+    struct worker * w = arg;
+    struct server_options * options = w->options;
+    struct event * evsignals[3] = {NULL, NULL, NULL};
+    const char * error = NULL;
+    int placed;
+    size_t i;
+
+    /* before event base and buffers are allocated, unpinned thread would be recorded as placed */
+    placed = nb_thread_place(nb_cpus_get(options->cpus, w->index));
+    nb_perf_attach(options->perf);
+    nb_cputime_attach(options->cputime);
+    evmem_attach(&w->allocations, options->echo_pool);
+
+    w->error = placed == -1 ? "Couldn't place server thread" : worker_init(w);
+    if (w->error)
+    {
+        puts(w->error);
+    }
+    pthread_barrier_wait(&workers_started);
+    for (i = 0; i < worker_count && !error; ++i)
     {
-        char * s = "Couldn't create listener";
+        error = workers[i].error;
+    }
+
+    if (w->index == 0)
+    {
+        /* SIGINT and SIGTERM only for server process, in-process server would take Ctrl-C from the client */
+        for (i = 0; i < (options->stop_signals ? 3 : 1) && !error; ++i)
+        {
+            evsignals[i] = evsignal_new(w->base, stop_signals[i], signal_cb, NULL);
+            evsignal_add(evsignals[i], NULL);
+        }
+        nb_ready_notify(options->ready_fd, error == NULL);
+    }
+    if (!error)
+    {
+        event_base_dispatch(w->base);
+    }
+
+    for (i = 0; i < 3; ++i)
+    {
+        if (evsignals[i])
+        {
+            event_free(evsignals[i]);
+        }
+    }
+    if (w->listener)
+    {
+        evconnlistener_free(w->listener);
+    }
+    if (w->notify_ev)
+    {
+        event_free(w->notify_ev);
+    }
+    if (w->base)
+    {
+        event_base_free(w->base);
+    }
+    evmem_detach();
+    return NULL;
+}
+
+void * server_thread(struct server_options * options)
+{
+    const char * error = NULL;
+    evutil_socket_t conn;
+    size_t i;
+
+    worker_count = options->threads;
+    workers = aligned_alloc(NB_CACHE_LINE, worker_count * sizeof(struct worker));
+    if (workers == NULL)
+    {
+        const char * s = "Couldn't allocate server threads";
         puts(s);
+        nb_ready_notify(options->ready_fd, 0);
         return (void *)s;
     }
+    memset(workers, 0, worker_count * sizeof(struct worker));
+    next_worker = 0;
+    pthread_barrier_init(&workers_started, NULL, (unsigned)worker_count);
 
-    event_base_dispatch(server_base);
+    for (i = 0; i < worker_count; ++i)
+    {
+        workers[i].options = options;
+        workers[i].index = i;
+        workers[i].notify_fd = -1;
+    }
+    for (i = 1; i < worker_count; ++i)
+    {
+        int err = pthread_create(&workers[i].tid, NULL, worker_run, &workers[i]);
+        if (err != 0)
+        {
+            /* started workers wait for all on barrier */
+            fprintf(stderr, "Couldn't start server thread: %s\n", strerror(err));
+            exit(1);
+        }
+    }
+    worker_run(&workers[0]);
 
-    evconnlistener_free(listener);
-    event_free(evstop);
-    event_base_free(server_base);
+    for (i = 1; i < worker_count; ++i)
+    {
+        pthread_join(workers[i].tid, NULL);
+    }
+    for (i = 0; i < worker_count; ++i)
+    {
+        /* handed off after worker stopped, listener is closed now */
+        while (fd_queue_pop(&workers[i].queue, &conn) == 0)
+        {
+            evutil_closesocket(conn);
+        }
+        if (workers[i].notify_fd != -1)
+        {
+            close(workers[i].notify_fd);
+        }
+        if (workers[i].error && !error)
+        {
+            error = workers[i].error;
+        }
+    }
+    pthread_barrier_destroy(&workers_started);
+    free(workers);
+    workers = NULL;
+    worker_count = 0;
 
-    return NULL;
+    return (void *)error;
 }
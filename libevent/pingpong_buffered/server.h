@@ -0,0 +1,39 @@
+#ifndef _PINGPONG_SERVER_H
+#define _PINGPONG_SERVER_H
+
+/*
+ * Ping-pong benchmark (server)
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <netbench/affinity.h>
+#include <netbench/cputime.h>
+#include <netbench/perf.h>
+
+struct server_options
+{
+    int port;
+    int framed; /* echo only whole length-prefixed frames */
+    size_t max_payload; /* max frame payload size in framed mode */
+    size_t threads; /* event loop threads, each with own event base */
+    int handoff; /* one listener hands accepted sockets to threads round-robin, otherwise listener per thread with SO_REUSEPORT */
+    const struct nb_cpus * cpus; /* event loop threads placement, round-robin */
+    struct nb_perf * perf; /* event loop threads counters group */
+    struct nb_cputime * cputime; /* event loop threads CPU time group */
+    int ready_fd; /* nb_ready_notify when all threads are listening, -1 - none */
+    int stop_signals; /* stop on SIGINT and SIGTERM too (server process), SIGHUP always stops */
+    int echo_pool; /* recycle evbuffer chain memory per thread, otherwise malloc/free per read */
+};
+
+/* Run server threads (first in the calling thread) until server_stop() or signal, return NULL or error message */
+void * server_thread(struct server_options * options);
+
+/* Stop server threads from any thread, server must be ready */
+void server_stop(void);
+
+/* libevent heap allocations of server threads, from any thread while server is running */
+uint64_t server_allocations(void);
+
+#endif /* _PINGPONG_SERVER_H */